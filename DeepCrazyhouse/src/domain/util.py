@@ -111,8 +111,10 @@ def get_numpy_arrays(pgn_dataset):
     :return: numpy-arrays:
             starting_idx - defines the index where each game starts
             x - the board representation for all games
+             (None if the dataset stores packed planes, see dataset_loader.unpack_planes())
             y_value - the game outcome (-1,0,1) for each board position
             y_policy - the movement policy for the next_move played
+             (None if the dataset stores the policy in sparse format, see dataset_loader.load_sparse_policy())
             plys_to_end - array of how many plys to the end of the game for each position.
              This can be used to apply discounting
             y_best_move_q - Q-value for the position of the selected move
@@ -120,9 +122,9 @@ def get_numpy_arrays(pgn_dataset):
     """
     # Get the data
     start_indices = np.array(pgn_dataset["start_indices"])
-    x = np.array(pgn_dataset["x"])
+    x = np.array(pgn_dataset["x"]) if "x" in pgn_dataset else None
     y_value = np.array(pgn_dataset["y_value"])
-    y_policy = np.array(pgn_dataset["y_policy"])
+    y_policy = np.array(pgn_dataset["y_policy"]) if "y_policy" in pgn_dataset else None
 
     possible_entries = ["plys_to_end", "y_best_move_q"]
     entries = [None] * 2
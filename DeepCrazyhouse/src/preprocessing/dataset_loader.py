@@ -7,11 +7,188 @@ Created on 22.10.18
 Please describe what the content of this file is about
 """
 import glob
+import json
 import logging
+import os
+import zlib
 import numpy as np
 import zarr
 from DeepCrazyhouse.configs.main_config import main_config
 from DeepCrazyhouse.src.domain.util import get_numpy_arrays, MATRIX_NORMALIZER
+from DeepCrazyhouse.src.domain.variants import constants
+
+
+def load_sparse_policy(pgn_dataset, nb_labels=None):
+    """
+    Loads the policy targets of a dataset which has been exported with the sparse policy format (Selfplay_Sparse_Policy)
+    and converts them into the dense representation.
+    The sparse format consists of the datasets:
+        y_policy_indices - policy index of every stored move
+        y_policy_probs - probability of every stored move
+        y_policy_begins - start position of the entries of each sample in y_policy_indices and y_policy_probs
+        y_policy_ends - end position (exclusive) of the entries of each sample in y_policy_indices and y_policy_probs
+    :param pgn_dataset: dataset file handle
+    :param nb_labels: Length of the dense policy vector. If None, constants.NB_LABELS is used
+    :return: y_policy: nd.array - Numpy array of shape (number samples, nb_labels) of type float32
+    """
+    if nb_labels is None:
+        nb_labels = constants.NB_LABELS
+
+    policy_ends = np.array(pgn_dataset["y_policy_ends"], dtype=np.int64)
+    if "y_policy_begins" in pgn_dataset:
+        policy_begins = np.array(pgn_dataset["y_policy_begins"], dtype=np.int64)
+    else:
+        # the entries of older files are stored contiguously, samples which haven't been written have an end position of 0
+        policy_ends = np.maximum.accumulate(policy_ends)
+        policy_begins = np.concatenate(([0], policy_ends[:-1]))
+
+    nb_samples = len(policy_ends)
+    y_policy = np.zeros((nb_samples, nb_labels), dtype=np.float32)
+    # samples which haven't been written have no entries
+    sample_ids = np.flatnonzero(policy_ends > policy_begins)
+    if len(sample_ids) == 0:
+        return y_policy
+    begins = policy_begins[sample_ids]
+    ends = policy_ends[sample_ids]
+
+    # consecutive samples with adjacent entries are loaded by a single read, so the unused capacity is never loaded
+    run_starts = np.flatnonzero(np.concatenate(([True], begins[1:] != ends[:-1])))
+    run_ends = np.concatenate((run_starts[1:], [len(sample_ids)]))
+    for run_start, run_end in zip(run_starts, run_ends):
+        entry_begin = int(begins[run_start])
+        entry_end = int(ends[run_end - 1])
+        policy_indices = np.array(pgn_dataset["y_policy_indices"][entry_begin:entry_end], dtype=np.int64)
+        policy_probs = np.array(pgn_dataset["y_policy_probs"][entry_begin:entry_end], dtype=np.float32)
+        entry_sample_ids = np.repeat(sample_ids[run_start:run_end], ends[run_start:run_end] - begins[run_start:run_end])
+        y_policy[entry_sample_ids, policy_indices] = policy_probs
+    return y_policy
+
+
+def unpack_planes(pgn_dataset, board_height=8, board_width=8):
+    """
+    Loads the input planes of a dataset which has been exported with the packed plane format (Selfplay_Pack_Planes)
+    and converts them into the plane representation.
+    The packed format consists of the datasets:
+        x_masks - uint64 bitboard for every sample and plane, bit i corresponds to the i-th square in row-major order
+        x_offsets - int16 offset for every sample and plane which is added to every square
+    :param pgn_dataset: dataset file handle
+    :param board_height: Number of rows of a plane
+    :param board_width: Number of columns of a plane
+    :return: x: nd.array - Numpy array of shape (number samples, number channels, board_height, board_width) of type int16
+    """
+    x_masks = np.array(pgn_dataset["x_masks"]).astype("<u8")
+    x_offsets = np.array(pgn_dataset["x_offsets"], dtype=np.int16)
+    nb_samples, nb_channels = x_masks.shape
+
+    # split every mask into its bytes (least significant first) and every byte into its bits (least significant first)
+    bits = np.unpackbits(x_masks.view(np.uint8).reshape(nb_samples, nb_channels, 8), axis=2, bitorder="little")
+    x = bits[:, :, :board_height * board_width].astype(np.int16)
+    x += x_offsets[:, :, np.newaxis]
+    return x.reshape(nb_samples, nb_channels, board_height, board_width)
+
+
+def load_sample_weights(pgn_dataset):
+    """
+    Loads the training weight of every sample (y_sample_weight) which is exported by the self-play playout cap randomization.
+    Full searches have a weight of 1 and fast searches the weight Centi_Quick_Sample_Weight / 100.
+    :param pgn_dataset: dataset file handle
+    :return: y_sample_weight: nd.array - Numpy array of type float32, all ones if the dataset doesn't contain sample weights
+    """
+    if "y_sample_weight" in pgn_dataset:
+        return np.array(pgn_dataset["y_sample_weight"], dtype=np.float32)
+    return np.ones(len(pgn_dataset["y_value"]), dtype=np.float32)
+
+
+def remove_unwritten_samples(pgn_dataset, start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q):
+    """
+    Removes the samples which have not been written by the self-play export: the unused end of a file and the padding
+    up to the next chunk after an export has been flushed or resumed. They have neither a policy target nor a sample weight.
+    The start indices are moved to the remaining samples.
+    :param pgn_dataset: dataset file handle
+    :return: start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q without the unwritten samples
+    """
+    mask = (y_policy.sum(axis=1) > 0) & (load_sample_weights(pgn_dataset) > 0)
+    if mask.all():
+        return start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q
+    # number of remaining samples in front of every sample index
+    remaining_before = np.concatenate(([0], np.cumsum(mask)))
+    start_indices = remaining_before[np.asarray(start_indices, dtype=np.int64)]
+
+    def apply_mask(array):
+        return None if array is None else array[mask]
+
+    return (start_indices, apply_mask(x), apply_mask(y_value), apply_mask(y_policy), apply_mask(plys_to_end),
+            apply_mask(y_best_move_q))
+
+
+def compute_shard_checksum(shard_path):
+    """
+    Computes the CRC-32 checksum of a self-play shard directory in the same way as the TrainDataExporter.
+    The relative path (zero terminated) and the content of every file are hashed in lexicographical order of the paths.
+    :param shard_path: Path to the shard directory (e.g. data_gpu_0_3.zarr)
+    :return: Checksum as a hexadecimal string of 8 characters
+    """
+    files = []
+    for root, _, file_names in os.walk(shard_path):
+        for file_name in file_names:
+            files.append(os.path.relpath(os.path.join(root, file_name), shard_path))
+
+    checksum = 0
+    for file in sorted(files):
+        checksum = zlib.crc32(file.encode() + b"\0", checksum)
+        with open(os.path.join(shard_path, file), "rb") as stream:
+            checksum = zlib.crc32(stream.read(), checksum)
+    return "%08x" % checksum
+
+
+def get_sealed_shards(directory, verify_checksum=True):
+    """
+    Returns all self-play shards of a directory which have been sealed by a manifest (Selfplay_Rotate_Shards).
+    Shards without a manifest are still being generated and are ignored.
+    :param directory: Directory which contains the shards and their manifests
+    :param verify_checksum: If True, shards whose checksum doesn't match the manifest are skipped
+    :return: List of (shard_path, manifest) tuples sorted by the shard path, they can be loaded by load_shard()
+    """
+    shards = []
+    for manifest_path in sorted(glob.glob(os.path.join(directory, "*.json"))):
+        with open(manifest_path) as manifest_file:
+            manifest = json.load(manifest_file)
+        if "checksum" not in manifest or "file" not in manifest:
+            continue
+        shard_path = os.path.join(directory, manifest["file"])
+        if verify_checksum and compute_shard_checksum(shard_path) != manifest["checksum"]:
+            logging.warning("checksum mismatch for shard %s, it will be skipped", shard_path)
+            continue
+        shards.append((shard_path, manifest))
+    return shards
+
+
+def load_shard(shard_path, manifest):
+    """
+    Loads a sealed self-play shard (see get_sealed_shards()). A shard is sealed when the next game doesn't fit anymore,
+    so only the first manifest["samples"] samples and manifest["games"] start indices have been written.
+    :param shard_path: Path to the shard directory
+    :param manifest: Manifest of the shard
+    :return: start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q (see get_numpy_arrays())
+    """
+    shard = zarr.open_group(shard_path, mode="r")
+    nb_samples = manifest["samples"]
+    dataset = {}
+    for key in shard.array_keys():
+        if key == "start_indices":
+            dataset[key] = shard[key][:manifest["games"]]
+        elif key in ("y_policy_indices", "y_policy_probs"):
+            # the entries are only read at the positions of the loaded samples
+            dataset[key] = shard[key]
+        else:
+            dataset[key] = shard[key][:nb_samples]
+
+    start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q = get_numpy_arrays(dataset)
+    if x is None:
+        x = unpack_planes(dataset)
+    if y_policy is None:
+        y_policy = load_sparse_policy(dataset)
+    return remove_unwritten_samples(dataset, start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q)
 
 
 def _load_dataset_file(dataset_filepath):
@@ -26,7 +203,13 @@ def _load_dataset_file(dataset_filepath):
             plys_to_end - array of how many plys to the end of the game for each position.
              This can be used to apply discounting
     """
-    return get_numpy_arrays(zarr.group(store=zarr.ZipStore(dataset_filepath, mode="r")))
+    pgn_dataset = zarr.group(store=zarr.ZipStore(dataset_filepath, mode="r"))
+    start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q = get_numpy_arrays(pgn_dataset)
+    if x is None:
+        x = unpack_planes(pgn_dataset)
+    if y_policy is None:
+        y_policy = load_sparse_policy(pgn_dataset)
+    return remove_unwritten_samples(pgn_dataset, start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q)
 
 
 def load_pgn_dataset(
@@ -78,6 +261,12 @@ def load_pgn_dataset(
 
     pgn_dataset = zarr.group(store=zarr.ZipStore(pgn_datasets[part_id], mode="r"))
     start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q = get_numpy_arrays(pgn_dataset)  # Get the data
+    if x is None:
+        x = unpack_planes(pgn_dataset)
+    if y_policy is None:
+        y_policy = load_sparse_policy(pgn_dataset)
+    start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q = remove_unwritten_samples(
+        pgn_dataset, start_indices, x, y_value, y_policy, plys_to_end, y_best_move_q)
 
     if verbose:
         logging.info("STATISTICS:")
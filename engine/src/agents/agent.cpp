@@ -54,6 +54,11 @@ Agent::Agent(PlaySettings* playSettings, bool verbose):
 {
 }
 
+bool Agent::sent_final_info() const
+{
+    return false;
+}
+
 void Agent::perform_action(Board *pos, SearchLimits* searchLimits, EvalInfo& evalInfo)
 {
     chrono::steady_clock::time_point start = chrono::steady_clock::now();
@@ -63,8 +68,15 @@ void Agent::perform_action(Board *pos, SearchLimits* searchLimits, EvalInfo& eva
     evalInfo.elapsedTimeMS = chrono::duration_cast<chrono::milliseconds>(end - start).count();
     evalInfo.nps = int(((evalInfo.nodes-evalInfo.nodesPreSearch) / (evalInfo.elapsedTimeMS / 1000.0f)) + 0.5f);
     set_best_move(evalInfo, pos->total_move_cout());
-    info_score(evalInfo);
+    if (!sent_final_info()) {
+        info_score(evalInfo);
+    }
     info_string(pos->fen());
-    info_bestmove(UCI::move(evalInfo.bestMove, pos->is_chess960()));
+    string bestMove = UCI::move(evalInfo.bestMove, pos->is_chess960());
+    if (evalInfo.pv.size() > 1 && evalInfo.pv[0] == evalInfo.bestMove) {
+        // the expected reply of the opponent allows the GUI to start pondering
+        bestMove += " ponder " + UCI::move(evalInfo.pv[1], pos->is_chess960());
+    }
+    info_bestmove(bestMove);
 }
 
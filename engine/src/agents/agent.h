@@ -51,6 +51,12 @@ protected:
     PlaySettings* playSettings;
     bool verbose;
 
+    /**
+     * @brief sent_final_info Returns true, if the agent has already sent the final "info" output of the last evaluation itself
+     * (e.g. one line per multipv entry), so it isn't repeated by perform_action()
+     */
+    virtual bool sent_final_info() const;
+
 public:
     Agent(PlaySettings* playSettings, bool verbose);
 
@@ -36,6 +36,16 @@ struct RLSettings
     size_t numberChunks;
     // size of a single chunk, the product of chunkSize and numberChunks is the amount of samples in an export file
     size_t chunkSize;
+    // exports the policy targets in sparse format (indices and probabilities of the legal moves) instead of dense NB_LABELS vectors
+    bool sparsePolicy;
+    // exports every input plane as a 64 bit mask and an offset instead of int16 values for each square
+    bool packPlanes;
+    // continues the export in a new shard file when the current one is full, full shards are sealed with a manifest
+    bool rotateShards;
+    // continues an existing export file after its last committed game instead of overwriting it
+    bool resumeExport;
+    // the subtree of the selected move including its visits is used as the root of the next search in self play
+    bool reuseTree;
     // the amount of nodes for the next search is slightly pertubated by sampling from +/- nodeRandomFactor * nodes
     float nodeRandomFactor;
     // Clips values in policy after move selection below this threshold to 0 in order to reduce noise from dirichletNoise in target policy
@@ -51,9 +61,27 @@ struct RLSettings
     float quickSearchQValueWeight;
     // dirchlet noise applied for quick search (recommended is 0, for maximum strength)
     float quickDirichletEpsilon;
+    // training weight of the samples of quick searches, for 0 only the full searches are exported
+    float quickSearchSampleWeight;
     // probability for applying a temperature on the raw policy for generating an opening position.
     // (5% - Temp: 10, 20% - Temp: 5, 75% - Temp: 2)
     float rawPolicyProbabilityTemperature;
+    // number of precomputed opening positions which are sampled in mini-batches of openingPoolBatchSize (0 = one raw policy evaluation per opening ply of every game)
+    size_t openingPoolSize;
+    size_t openingPoolBatchSize;
+    // every opening is used once and the pool is refilled in the background, otherwise the openings are drawn with replacement
+    bool openingPoolRefill;
+    // number of games which are generated concurrently with their own search trees and a shared network (1 = serial self play)
+    size_t numberParallelGames;
+    // maximum time in microseconds which an inference request of a parallel game waits for the requests of the other games
+    size_t dispatcherFlushMicros;
+    // stops the arena as soon as the sequential probability ratio test (SPRT) of H0: elo <= sprtElo0 against H1: elo >= sprtElo1 has a decision
+    bool arenaSPRT;
+    float sprtElo0;
+    float sprtElo1;
+    // probabilities of a false positive (alpha) and a false negative (beta) decision
+    float sprtAlpha;
+    float sprtBeta;
 };
 
 #endif // RLSETTINGS_H
@@ -27,6 +27,7 @@
 
 SearchSettings::SearchSettings():
         threads(2),
+        postProcessingThreads(0),
         batchSize(2),
         dirichletEpsilon(0.25f),
         dirichletAlpha(0.2f),
@@ -37,6 +38,7 @@ SearchSettings::SearchSettings():
         enhanceChecks(true),
         enhanceCaptures(true),
         useTranspositionTable(true),
+        reconstructPositions(false),
         cpuctInit(2.5f),
         cpuctBase(19652.0f),
         uInit(1.0f),
@@ -49,7 +51,17 @@ SearchSettings::SearchSettings():
         threshCheck(0.1f),
         checkFactor(0.5f),
         threshCapture(0.02f),
-        captureFactor(0.05f)
+        captureFactor(0.05f),
+        adaptiveVirtualLoss(false),
+        targetCollisionRatio(0.1f),
+        maxVirtualLoss(30.0f),
+        multiVisitCollisions(false),
+        allocationStatistics(false),
+        infoIntervalMS(1000),
+        hashFullNodes(1000000),
+        multiPV(1),
+        dynamicTimeManager(false),
+        timeTraceFile("<empty>")
 {
 
 }
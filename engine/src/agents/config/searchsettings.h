@@ -28,6 +28,7 @@
 #ifndef SEARCHSETTINGS_H
 #define SEARCHSETTINGS_H
 
+#include <string>
 #include "uci.h"
 
 using namespace UCI;
@@ -35,6 +36,8 @@ using namespace UCI;
 struct SearchSettings
 {
     size_t threads;
+    // number of additional worker threads per search thread for filling the NN results of a mini-batch (0 = serial)
+    size_t postProcessingThreads;
     unsigned int batchSize;
     float dirichletEpsilon;
     float dirichletAlpha;
@@ -47,6 +50,8 @@ struct SearchSettings
     bool enhanceCaptures;
 //    bool useFutureQValues;  currently not supported
     bool useTranspositionTable;
+    // if true, nodes don't keep their own board position and the search threads reconstruct it on demand via do_move/undo_move
+    bool reconstructPositions;
     float cpuctInit;
     float cpuctBase;
     float uInit;
@@ -68,6 +73,26 @@ struct SearchSettings
     float captureFactor;
     // If true, the exact given node count doesn't need to reached, but search can be stopped earlier
     bool allowEarlyStopping;
+    // If true, every search thread adapts its virtual loss to keep the ratio of collisions in its mini-batches low
+    bool adaptiveVirtualLoss;
+    // ratio of collisions per mini-batch above which the adaptive virtual loss is increased (currently not as UCI parameter)
+    float targetCollisionRatio;
+    // upper bound for the adaptive virtual loss (currently not as UCI parameter)
+    float maxVirtualLoss;
+    // If true, collisions on nodes which received their NN evaluation in the meantime are backed up as regular visits
+    bool multiVisitCollisions;
+    // If true, the average number of heap allocations per node expansion is sent as an "info string" after every search
+    bool allocationStatistics;
+    // interval in milliseconds in which "info" lines are sent during the search (0 disables the periodic output)
+    int infoIntervalMS;
+    // number of transposition table entries which is reported as a full table ("hashfull" 1000)
+    size_t hashFullNodes;
+    // number of best root moves for which an "info" line with their principal variation is sent
+    size_t multiPV;
+    // If true, the movetime is adapted during the search based on the root statistics (see DynamicTimeManager)
+    bool dynamicTimeManager;
+    // file to which the root statistics of every timed search are appended for the time manager simulation ("<empty>" disables it)
+    std::string timeTraceFile;
 
     SearchSettings();
 
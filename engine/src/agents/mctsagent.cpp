@@ -24,6 +24,7 @@
  */
 
 #include "mctsagent.h"
+#include <fstream>
 #include "../evalinfo.h"
 #include "movegen.h"
 #include "inputrepresentation.h"
@@ -34,6 +35,7 @@
 #include "uci.h"
 #include "../manager/statesmanager.h"
 #include "../manager/treemanager.h"
+#include "../manager/treestatistics.h"
 #include "../node.h"
 #include "../util/communication.h"
 
@@ -53,15 +55,19 @@ MCTSAgent::MCTSAgent(NeuralNetAPI *netSingle, NeuralNetAPI** netBatches,
     opponentsNextRoot(nullptr),
     states(states),
     lastValueEval(-1.0f),
-    reusedFullTree(false)
+    reusedFullTree(false),
+    multiPVInfoSent(false),
+    stopRequested(false),
+    ponderHit(false)
 {
     mapWithMutex = new MapWithMutex();
     mapWithMutex->hashTable = new unordered_map<Key, Node*>;
-    mapWithMutex->hashTable->reserve(1e6);
+    mapWithMutex->update_fill_statistics();
 
     for (auto i = 0; i < searchSettings->threads; ++i) {
         searchThreads.push_back(new SearchThread(netBatches[i], searchSettings, mapWithMutex));
     }
+    searchPool = new WorkerPool(searchSettings->threads);
 
     valueOutput = new NDArray(Shape(1, 1), Context::cpu());
 
@@ -71,12 +77,14 @@ MCTSAgent::MCTSAgent(NeuralNetAPI *netSingle, NeuralNetAPI** netBatches,
         probOutputs = new NDArray(Shape(1, NB_LABELS), Context::cpu());
     }
     timeManager = new TimeManager(searchSettings->randomMoveFactor);
-    generator = default_random_engine(r());
+    dynamicTimeManager = new DynamicTimeManager();
     fill(inputPlanes, inputPlanes+NB_VALUES_TOTAL, 0.0f);  // will be filled in evalute_board_state()
 }
 
 MCTSAgent::~MCTSAgent()
 {
+    delete searchPool;
+    delete dynamicTimeManager;
     for (size_t i = 0; i < searchSettings->threads; ++i) {
         delete netBatches[i];
     }
@@ -130,9 +138,18 @@ size_t MCTSAgent::init_root_node(Board *pos)
     rootNode = get_root_node_from_tree(pos);
 
     if (rootNode != nullptr) {
-        // swap the states because now the old states are used
-        // This way the memory won't be freed for the next new move
-        states->swap_states();
+        if (rootNode->get_pos() == nullptr) {
+            // the node was created on a working board, so the root gets its own copy of the current position
+            // which references the active states, hence these must be kept instead of the old ones
+            Board* newPos = new Board(*pos);
+            newPos->set_state_info(new StateInfo(*(pos->get_state_info())));
+            rootNode->set_pos(newPos);
+        }
+        else {
+            // swap the states because now the old states are used
+            // This way the memory won't be freed for the next new move
+            states->swap_states();
+        }
         nodesPreSearch = size_t(rootNode->get_visits());
         info_string(nodesPreSearch, "nodes of former tree will be reused");
     }
@@ -172,20 +189,269 @@ Node *MCTSAgent::get_root_node_from_tree(Board *pos)
     return nullptr;
 }
 
-void MCTSAgent::stop_search_based_on_limits()
+void MCTSAgent::monitor_search()
 {
-    int curMovetime = timeManager->get_time_for_move(searchLimits, rootNode->get_pos()->side_to_move(), rootNode->get_pos()->plies_from_null()/2);
-    info_string("movetime", curMovetime);
-    this_thread::sleep_for(chrono::milliseconds(curMovetime/2));
-    if (early_stopping()) {
-        stop_search();
-    } else {
-        this_thread::sleep_for(chrono::milliseconds(curMovetime/2));
-        if (continue_search()) {
-            this_thread::sleep_for(chrono::milliseconds(curMovetime/2));
+    // without a time limit the search only ends by the node limit or an external stop request
+    const bool useTimeLimit = !searchLimits->infinite && (searchSettings->allowEarlyStopping || searchLimits->nodes == 0);
+    // while pondering the clock of the opponent is running, so the time limit only starts with a "ponderhit"
+    bool pondering = searchLimits->ponder && !ponderHit;
+    int curMovetime = 0;
+    chrono::steady_clock::time_point startTime;
+    float visitsPreSearch = 0;
+    int deadline = 0;
+    bool earlyStoppingChecked = false;
+    bool extensionChecked = false;
+    // the periodic info output refers to the whole search including a possible ponder phase
+    const chrono::steady_clock::time_point searchStartTime = chrono::steady_clock::now();
+    const size_t nodesPreSearch = size_t(rootNode->get_visits());
+    int nextInfoMS = searchSettings->infoIntervalMS;
+    // the root statistics are only collected if they are used by the dynamic time manager or recorded for the time manager simulation
+    const bool recordTrace = useTimeLimit && searchSettings->timeTraceFile != "<empty>";
+    const bool takeSnapshots = useTimeLimit && (searchSettings->dynamicTimeManager || recordTrace);
+    SearchTrace trace;
+
+    auto start_time_limit = [&]() {
+        if (useTimeLimit) {
+            const Color me = rootNode->get_pos()->side_to_move();
+            curMovetime = timeManager->get_time_for_move(searchLimits, me, rootNode->get_pos()->plies_from_null()/2);
+            info_string("movetime", curMovetime);
+            trace.movetime = curMovetime;
+            trace.maxTimeMS = timeManager->get_max_time_for_move(searchLimits, me, curMovetime);
+            dynamicTimeManager->start(trace.movetime, trace.maxTimeMS);
+        }
+        startTime = chrono::steady_clock::now();
+        visitsPreSearch = rootNode->get_visits();
+        deadline = curMovetime;
+    };
+    if (!pondering) {
+        start_time_limit();
+    }
+
+    // the waiting ends as soon as all search threads have finished by themselves (e.g. when the node limit is reached)
+    while (!searchPool->wait_all_for(chrono::milliseconds(SEARCH_MONITOR_TICK_MS))) {
+        if (searchSettings->infoIntervalMS > 0) {
+            const int searchMS = int(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - searchStartTime).count());
+            if (searchMS >= nextInfoMS) {
+                print_search_info(searchMS, nodesPreSearch);
+                nextInfoMS = searchMS + searchSettings->infoIntervalMS;
+            }
+        }
+        if (stopRequested) {
+            break;
+        }
+        if (pondering) {
+            if (!ponderHit) {
+                continue;
+            }
+            pondering = false;
+            start_time_limit();
+        }
+        if (!useTimeLimit) {
+            continue;
+        }
+        const int elapsedMS = int(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count());
+        if (takeSnapshots) {
+            const RootSnapshot snapshot = get_root_snapshot(elapsedMS);
+            if (recordTrace) {
+                trace.snapshots.push_back(snapshot);
+            }
+            if (searchSettings->dynamicTimeManager && dynamicTimeManager->should_stop(snapshot) &&
+                    (searchSettings->allowEarlyStopping || elapsedMS >= curMovetime)) {
+                info_string("Dynamic time manager -> stop search");
+                break;
+            }
+        }
+        if (!searchSettings->dynamicTimeManager) {
+            if (!earlyStoppingChecked && elapsedMS >= curMovetime/2) {
+                earlyStoppingChecked = true;
+                if (early_stopping()) {
+                    break;
+                }
+            }
+            if (!extensionChecked && elapsedMS >= curMovetime) {
+                extensionChecked = true;
+                if (continue_search()) {
+                    deadline += curMovetime/2;
+                }
+            }
+            if (elapsedMS >= deadline) {
+                break;
+            }
+        }
+        if (searchSettings->allowEarlyStopping && elapsedMS > 0) {
+            if (rootNode->get_checkmate_idx() != -1) {
+                info_string("Found mate -> early stopping");
+                break;
+            }
+            // the visit rate is only extrapolated after every search thread had the chance to return a mini-batch,
+            // otherwise the gap of a reused tree would stop the search before any new evaluation has arrived
+            const float newVisits = rootNode->get_visits() - visitsPreSearch;
+            if (elapsedMS < curMovetime / 10 || newVisits < searchSettings->threads * searchSettings->batchSize) {
+                continue;
+            }
+            // a possible search extension is taken into account until it has been decided
+            int remainingMS = (extensionChecked ? deadline : curMovetime + curMovetime/2) - elapsedMS;
+            if (searchSettings->dynamicTimeManager) {
+                remainingMS = dynamicTimeManager->get_hard_cap() - elapsedMS;
+            }
+            float remainingVisits = newVisits / elapsedMS * remainingMS;
+            if (searchLimits->nodes != 0) {
+                remainingVisits = min(remainingVisits, searchLimits->nodes - rootNode->get_visits());
+            }
+            if (best_move_unreachable(remainingVisits)) {
+                info_string("Best move can't be overtaken -> early stopping");
+                break;
+            }
+        }
+    }
+    stop_search();
+
+    if (recordTrace && !trace.snapshots.empty()) {
+        ofstream traceFile(searchSettings->timeTraceFile, ios::app);
+        write_search_trace(traceFile, trace);
+    }
+
+    wait_for_stop_request();
+}
+
+void MCTSAgent::wait_for_stop_request()
+{
+    while (!stopRequested && (searchLimits->infinite || (searchLimits->ponder && !ponderHit))) {
+        this_thread::sleep_for(chrono::milliseconds(SEARCH_MONITOR_TICK_MS));
+    }
+}
+
+RootSnapshot MCTSAgent::get_root_snapshot(int elapsedMS) const
+{
+    // the root statistics are read without locking the root node (see print_search_info())
+    const DynamicVector<float> childNumberVisits = rootNode->get_child_number_visits();
+    RootSnapshot snapshot;
+    snapshot.elapsedMS = elapsedMS;
+    snapshot.bestIdx = 0;
+    snapshot.bestVisitShare = 0;
+    // a single move can't be overtaken, which is expressed by the maximum difference of two Q-values
+    snapshot.qGap = 2.0f;
+
+    size_t secondIdx = childNumberVisits.size();
+    for (size_t childIdx = 1; childIdx < childNumberVisits.size(); ++childIdx) {
+        if (childNumberVisits[childIdx] > childNumberVisits[snapshot.bestIdx]) {
+            secondIdx = snapshot.bestIdx;
+            snapshot.bestIdx = childIdx;
         }
-        stop_search();
+        else if (secondIdx == childNumberVisits.size() || childNumberVisits[childIdx] > childNumberVisits[secondIdx]) {
+            secondIdx = childIdx;
+        }
+    }
+    const float visitSum = sum(childNumberVisits);
+    if (visitSum > 0) {
+        snapshot.bestVisitShare = childNumberVisits[snapshot.bestIdx] / visitSum;
+    }
+    if (secondIdx != childNumberVisits.size()) {
+        snapshot.qGap = rootNode->get_q_value(snapshot.bestIdx) - rootNode->get_q_value(secondIdx);
+    }
+    return snapshot;
+}
+
+bool MCTSAgent::best_move_unreachable(float remainingVisits)
+{
+    const size_t numberChildNodes = rootNode->get_number_child_nodes();
+    if (numberChildNodes < 2) {
+        return false;
+    }
+    DynamicVector<float> mctsPolicy(numberChildNodes);
+    DynamicVector<float> qValues(numberChildNodes);
+    rootNode->lock();
+    rootNode->get_mcts_policy(mctsPolicy);
+    const DynamicVector<float> childNumberVisits = rootNode->get_child_number_visits();
+    const float visits = rootNode->get_visits();
+    for (size_t childIdx = 0; childIdx < numberChildNodes; ++childIdx) {
+        qValues[childIdx] = rootNode->get_q_value(childIdx);
+    }
+    rootNode->unlock();
+
+    // same score as in get_mcts_policy() before the normalization, the Q-values are assumed to stay constant
+    const float qValueWeight = searchSettings->qValueWeight;
+    const float finalVisits = visits + remainingVisits;
+    const float quantile = get_quantile(DynamicVector<float>(childNumberVisits / visits), 0.25f);
+    const size_t bestIdx = argmax(mctsPolicy);
+    float bestQ = 0;
+    if (childNumberVisits[bestIdx] / visits >= quantile) {
+        bestQ = (qValues[bestIdx] + 1) * 0.5f;
+    }
+    const float bestScore = (1.0f - qValueWeight) * childNumberVisits[bestIdx] / finalVisits + qValueWeight * bestQ;
+
+    for (size_t childIdx = 0; childIdx < numberChildNodes; ++childIdx) {
+        if (childIdx == bestIdx) {
+            continue;
+        }
+        // the challenger receives all remaining visits, so its Q-value won't be pruned
+        const float score = (1.0f - qValueWeight) * (childNumberVisits[childIdx] + remainingVisits) / finalVisits +
+                qValueWeight * (qValues[childIdx] + 1) * 0.5f;
+        if (score >= bestScore) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t MCTSAgent::get_max_depth() const
+{
+    size_t maxDepth = 0;
+    for (auto searchThread : searchThreads) {
+        maxDepth = max(maxDepth, searchThread->get_max_depth());
+    }
+    return maxDepth;
+}
+
+int MCTSAgent::get_hash_full() const
+{
+    return int(min(size_t(1000), mapWithMutex->numberEntries * 1000 / max(size_t(1), searchSettings->hashFullNodes)));
+}
+
+void MCTSAgent::print_search_info(int elapsedMS, size_t nodesPreSearch) const
+{
+    EvalInfo evalInfo;
+    const size_t maxDepth = get_max_depth();
+    evalInfo.nodes = size_t(rootNode->get_visits());
+    evalInfo.elapsedTimeMS = elapsedMS;
+    evalInfo.nps = int(((evalInfo.nodes - nodesPreSearch) / max(elapsedMS / 1000.0f, 0.001f)) + 0.5f);
+    evalInfo.hashFull = get_hash_full();
+    evalInfo.isChess960 = rootNode->get_pos()->is_chess960();
+
+    if (searchSettings->multiPV <= 1) {
+        evalInfo.centipawns = value_to_centipawn(rootNode->updated_value_eval());
+        rootNode->get_principal_variation(evalInfo.pv);
+        evalInfo.depth = evalInfo.pv.size();
+        evalInfo.selDepth = max(evalInfo.depth, maxDepth);
+        info_score(evalInfo);
+        return;
     }
+    vector<size_t> childIndices;
+    rootNode->get_best_child_indices(searchSettings->multiPV, childIndices);
+    for (size_t rank = 0; rank < childIndices.size(); ++rank) {
+        const size_t childIdx = childIndices[rank];
+        evalInfo.centipawns = value_to_centipawn(rootNode->get_q_value(childIdx));
+        rootNode->get_principal_variation(childIdx, evalInfo.pv);
+        evalInfo.depth = evalInfo.pv.size();
+        evalInfo.selDepth = max(evalInfo.depth, maxDepth);
+        info_multi_pv(rank+1, evalInfo);
+    }
+}
+
+void MCTSAgent::request_stop()
+{
+    stopRequested = true;
+}
+
+void MCTSAgent::ponder_hit()
+{
+    ponderHit = true;
+}
+
+void MCTSAgent::clear_search_requests()
+{
+    stopRequested = false;
+    ponderHit = false;
 }
 
 void MCTSAgent::stop_search()
@@ -278,6 +544,18 @@ void MCTSAgent::apply_move_to_tree(Move move, bool ownMove, Board* pos)
     }
 }
 
+void MCTSAgent::reuse_child_as_next_root(Move move)
+{
+    if (rootNode == nullptr) {
+        return;
+    }
+    // the siblings of the next root are deleted in get_root_node_from_tree() when the next search starts
+    opponentsNextRoot = pick_next_node(move, rootNode);
+    if (opponentsNextRoot != nullptr) {
+        gameNodes.push_back(opponentsNextRoot);
+    }
+}
+
 void MCTSAgent::clear_game_history()
 {
     delete_old_tree();
@@ -285,6 +563,7 @@ void MCTSAgent::clear_game_history()
 
     assert(mapWithMutex->hashTable->size() == 0);
     mapWithMutex->hashTable->clear();
+    mapWithMutex->update_fill_statistics();
     oldestRootNode = nullptr;
     ownNextRoot = nullptr;
     opponentsNextRoot = nullptr;
@@ -292,6 +571,11 @@ void MCTSAgent::clear_game_history()
     lastValueEval = -1.0f;
 }
 
+bool MCTSAgent::sent_final_info() const
+{
+    return multiPVInfoSent;
+}
+
 bool MCTSAgent::is_policy_map()
 {
     return netSingle->is_policy_map();
@@ -304,7 +588,12 @@ string MCTSAgent::get_name() const
 
 void MCTSAgent::evaluate_board_state(Board *pos, EvalInfo& evalInfo)
 {
+    const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    multiPVInfoSent = false;
     size_t nodesPreSearch = init_root_node(pos);
+    // the subtrees which aren't reused have been removed from the hash table
+    mapWithMutex->update_fill_statistics();
+    bool searched = false;
     if (rootNode->get_number_child_nodes() == 1 && int(rootNode->get_visits()) != 0) {
         info_string("Only single move available -> early stopping");
     }
@@ -325,13 +614,32 @@ void MCTSAgent::evaluate_board_state(Board *pos, EvalInfo& evalInfo)
             rootNode->make_to_root();
         }
 
-        for (Node* childNode : rootNode->get_child_nodes()) {
-            if (childNode != nullptr) {
-                childNode->enhance_moves();
+        for (size_t childIdx = 0; childIdx < rootNode->get_number_child_nodes(); ++childIdx) {
+            Node* childNode = rootNode->get_child_node(childIdx);
+            if (childNode == nullptr) {
+                continue;
+            }
+            if (childNode->get_pos() != nullptr) {
+                childNode->enhance_moves(childNode->get_pos());
+            }
+            else {
+                // the board destructor only frees the state info of the applied move
+                Board childPos(*rootNode->get_pos());
+                childPos.do_move(rootNode->get_move(childIdx), *(new StateInfo));
+                childNode->enhance_moves(&childPos);
             }
         }
         info_string("run mcts search");
         run_mcts_search();
+        searched = true;
+        if (searchSettings->multiPV > 1) {
+            print_search_info(int(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count()), nodesPreSearch);
+            multiPVInfoSent = true;
+        }
+    }
+    if (!searched) {
+        // the move is already known, but it must not be sent before the ponder or infinite search has been ended
+        wait_for_stop_request();
     }
     evalInfo.childNumberVisits = rootNode->get_child_number_visits();
     evalInfo.policyProbSmall.resize(rootNode->get_number_child_nodes());
@@ -340,30 +648,104 @@ void MCTSAgent::evaluate_board_state(Board *pos, EvalInfo& evalInfo)
     lastValueEval = rootNode->updated_value_eval();
     evalInfo.bestMoveQ = lastValueEval;
     evalInfo.centipawns = value_to_centipawn(lastValueEval);
-    evalInfo.legalMoves = rootNode->get_legal_moves();
+    const Span<const Move> legalMoves = rootNode->get_legal_moves();
+    evalInfo.legalMoves.assign(legalMoves.begin(), legalMoves.end());
     rootNode->get_principal_variation(evalInfo.pv);
     evalInfo.depth = evalInfo.pv.size();
+    evalInfo.selDepth = searched ? max(evalInfo.depth, get_max_depth()) : evalInfo.depth;
+    evalInfo.hashFull = get_hash_full();
     evalInfo.isChess960 = pos->is_chess960();
     evalInfo.nodes = size_t(rootNode->get_visits());
     evalInfo.nodesPreSearch = nodesPreSearch;
+    // a request which arrived after the search has ended mustn't affect the next search
+    clear_search_requests();
 }
 
 void MCTSAgent::run_mcts_search()
 {
-    thread** threads = new thread*[searchSettings->threads];
     for (size_t i = 0; i < searchSettings->threads; ++i) {
         searchThreads[i]->set_root_node(rootNode);
         searchThreads[i]->set_search_limits(searchLimits);
-        threads[i] = new thread(go, searchThreads[i]);
+        searchThreads[i]->set_is_running(true);
+        SearchThread* searchThread = searchThreads[i];
+        searchPool->enqueue([searchThread]{ go(searchThread); });
     }
-    if (searchSettings->allowEarlyStopping || searchLimits->nodes == 0) {
-        // otherwise the threads will stop by themselves
-        stop_search_based_on_limits();
+    monitor_search();
+    searchPool->wait_all();
+    if (searchSettings->allocationStatistics) {
+        print_allocation_statistics();
     }
-    for (size_t i = 0; i < searchSettings->threads; ++i) {
-        threads[i]->join();
+    print_batch_statistics();
+#ifdef PHASE_PROFILING
+    print_phase_profile();
+#endif
+}
+
+void MCTSAgent::print_allocation_statistics() const
+{
+    const size_t numberExpansions = get_number_expansions();
+    if (numberExpansions != 0) {
+        info_string("allocations per expansion", float(get_number_allocations()) / numberExpansions);
+    }
+}
+
+#ifdef PHASE_PROFILING
+void MCTSAgent::print_phase_profile() const
+{
+    PhaseProfile profile;
+    for (auto searchThread : searchThreads) {
+        profile.merge(searchThread->get_phase_profile());
+    }
+    ::print_phase_profile(profile);
+}
+#endif
+
+void MCTSAgent::print_batch_statistics() const
+{
+    size_t numberBatches = 0;
+    size_t numberSelections = 0;
+    size_t numberCollisions = 0;
+    size_t numberNewNodes = 0;
+    size_t numberCollisionVisits = 0;
+    float virtualLoss = 0;
+    for (auto searchThread : searchThreads) {
+        numberBatches += searchThread->get_number_batches();
+        numberSelections += searchThread->get_number_selections();
+        numberCollisions += searchThread->get_number_collisions();
+        numberNewNodes += searchThread->get_number_new_nodes();
+        numberCollisionVisits += searchThread->get_number_collision_visits();
+        virtualLoss += searchThread->get_virtual_loss();
+    }
+    if (numberSelections != 0) {
+        info_string("collision ratio", float(numberCollisions) / numberSelections);
+    }
+    if (numberBatches != 0) {
+        info_string("batch fill", float(numberNewNodes) / (numberBatches * searchSettings->batchSize));
+    }
+    if (searchSettings->adaptiveVirtualLoss) {
+        info_string("virtual loss", virtualLoss / searchThreads.size());
+    }
+    if (searchSettings->multiVisitCollisions) {
+        info_string("collisions backed up as visits", numberCollisionVisits);
     }
-    delete[] threads;
+}
+
+size_t MCTSAgent::get_number_expansions() const
+{
+    size_t numberExpansions = 0;
+    for (auto searchThread : searchThreads) {
+        numberExpansions += searchThread->get_number_expansions();
+    }
+    return numberExpansions;
+}
+
+size_t MCTSAgent::get_number_allocations() const
+{
+    size_t numberAllocations = 0;
+    for (auto searchThread : searchThreads) {
+        numberAllocations += searchThread->get_number_allocations();
+    }
+    return numberAllocations;
 }
 
 void MCTSAgent::print_root_node()
@@ -374,3 +756,13 @@ void MCTSAgent::print_root_node()
     }
     print_node_statistics(rootNode);
 }
+
+void MCTSAgent::print_tree_statistics()
+{
+    if (rootNode == nullptr) {
+        info_string("You must do a search before you can print the tree statistics");
+        return;
+    }
+    const TreeStatistics stats = compute_tree_statistics(rootNode, mapWithMutex->hashTable, max(size_t(1), size_t(thread::hardware_concurrency())));
+    ::print_tree_statistics(stats);
+}
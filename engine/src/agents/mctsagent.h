@@ -34,6 +34,7 @@
 #define MCTSAGENT_H
 
 #include <thread>
+#include <atomic>
 #include "position.h"
 #include "agent.h"
 #include "../evalinfo.h"
@@ -46,6 +47,11 @@
 #include "../searchthread.h"
 #include "../manager/statesmanager.h"
 #include "../manager/timemanager.h"
+#include "../manager/dynamictimemanager.h"
+#include "../util/workerpool.h"
+
+// interval in milliseconds in which the search monitor checks the stop conditions
+const int SEARCH_MONITOR_TICK_MS = 10;
 
 class MCTSAgent : public Agent
 {
@@ -55,12 +61,16 @@ private:
 
     SearchSettings* searchSettings;
     std::vector<SearchThread*> searchThreads;
+    // persistent workers which run the search threads, so that no threads need to be created for every move
+    WorkerPool* searchPool;
 
     float inputPlanes[NB_VALUES_TOTAL];
     NDArray* valueOutput;
     NDArray* probOutputs;
 
     TimeManager* timeManager;
+    // adapts the movetime to the root statistics if searchSettings->dynamicTimeManager is set
+    DynamicTimeManager* dynamicTimeManager;
 
     Node* rootNode;
     // The oldes root node stores a reference to the node with with the current root nodes is based on.
@@ -82,6 +92,13 @@ private:
 
     // boolean which indicates if the same node was requested twice for analysis
     bool reusedFullTree;
+    // the "info multipv" lines of the last evaluation have been sent
+    bool multiPVInfoSent;
+
+    // is set by request_stop() and checked by the search monitor
+    atomic<bool> stopRequested;
+    // is set by ponder_hit() and turns a ponder search into a regular search with a time limit
+    atomic<bool> ponderHit;
 
     /**
      * @brief reuse_tree Checks if the postion is know and if the tree or parts of the tree can be reused.
@@ -101,10 +118,33 @@ private:
     inline Node* get_root_node_from_tree(Board* pos);
 
     /**
-     * @brief stop_search_based_on_limits Checks for the search limit condition and possible early break-ups
-     * and stops all running search threads accordingly
+     * @brief monitor_search Wakes up every SEARCH_MONITOR_TICK_MS or as soon as all search threads have finished and checks the stop conditions:
+     * An external stop request, the time limit or the decision of the dynamic time manager, early stopping, a found mate and a best move which can't be overtaken by the remaining visits.
+     * All running search threads are stopped afterwards. Every searchSettings->infoIntervalMS an "info" line about the search is sent.
      */
-    inline void stop_search_based_on_limits();
+    void monitor_search();
+
+    /**
+     * @brief best_move_unreachable Checks if the best move of the root can't be overtaken anymore.
+     * The moves are compared by the Q-value weighted score of get_mcts_policy() which also selects the final move.
+     * @param remainingVisits Estimated number of visits which can still be done in the remaining search time
+     * @return True, if no other move would reach the score of the best move even if it received all remaining visits
+     */
+    bool best_move_unreachable(float remainingVisits);
+
+    /**
+     * @brief wait_for_stop_request Blocks until "stop" (or "ponderhit" for a ponder search) has been received if the current search
+     * is an infinite or ponder search, because the UCI protocol doesn't allow to send the best move earlier
+     */
+    void wait_for_stop_request();
+
+    bool sent_final_info() const override;
+
+    /**
+     * @brief get_root_snapshot Collects the root statistics for the dynamic time manager without locking the root node
+     * @param elapsedMS Elapsed time since the start of the time limit
+     */
+    RootSnapshot get_root_snapshot(int elapsedMS) const;
 
     /**
      * @brief stop_search Stops all search threads
@@ -139,7 +179,61 @@ private:
      */
     void delete_game_nodes();
 
+    /**
+     * @brief print_allocation_statistics Prints the average number of heap allocations per node expansion of the last search
+     */
+    void print_allocation_statistics() const;
+
+    /**
+     * @brief print_batch_statistics Prints the collision ratio and the average mini-batch fill of the last search
+     * as well as the average virtual loss in case it is adapted
+     */
+    void print_batch_statistics() const;
+
+    /**
+     * @brief get_max_depth Returns the maximum rollout depth over all search threads of the current search (seldepth)
+     */
+    size_t get_max_depth() const;
+
+    /**
+     * @brief get_hash_full Returns the filling of the transposition table in permill of the configured node budget
+     * (searchSettings->hashFullNodes). The value is read without locking the hash table.
+     */
+    int get_hash_full() const;
+
+    /**
+     * @brief print_search_info Sends an "info" line about the running search or searchSettings->multiPV lines for the best root moves.
+     * The root statistics are read without locking the root node, so the search threads are never blocked.
+     * The child vectors of a node are allocated once at expansion, so these reads can at most return slightly outdated values.
+     * @param elapsedMS Elapsed time since the start of the search
+     * @param nodesPreSearch Number of root visits before the search was started
+     */
+    void print_search_info(int elapsedMS, size_t nodesPreSearch) const;
+
+#ifdef PHASE_PROFILING
+    /**
+     * @brief print_phase_profile Prints the accumulated time of each search phase over all search threads of the last search
+     */
+    void print_phase_profile() const;
+#endif
+
 public:
+    /**
+     * @brief request_stop Stops the current search as soon as possible. This can be called from a different thread.
+     */
+    void request_stop();
+
+    /**
+     * @brief ponder_hit Informs the agent that the opponent has played the expected move.
+     * The current ponder search continues as a regular search and starts its time limit. This can be called from a different thread.
+     */
+    void ponder_hit();
+
+    /**
+     * @brief clear_search_requests Resets pending stop and ponderhit requests. Must be called before a new search is started.
+     */
+    void clear_search_requests();
+
     MCTSAgent(NeuralNetAPI* netSingle,
               NeuralNetAPI** netBatches,
               SearchSettings* searchSettings,
@@ -162,6 +256,23 @@ public:
      */
     void print_root_node();
 
+    /**
+     * @brief print_tree_statistics Walks the current search tree in parallel and prints its node count, shape and memory footprint
+     */
+    void print_tree_statistics();
+
+    /**
+     * @brief get_number_expansions Returns the number of node expansions of all search threads during the last search
+     * @return size_t
+     */
+    size_t get_number_expansions() const;
+
+    /**
+     * @brief get_number_allocations Returns the number of heap allocations of all search threads for node expansions during the last search
+     * @return size_t
+     */
+    size_t get_number_allocations() const;
+
     /**
      * @brief apply_move_to_tree Applies the given move to the search tree by adding the expanded node to the candidate list
      * @param m Move
@@ -170,6 +281,14 @@ public:
      */
     void apply_move_to_tree(Move move, bool ownMove, Board* pos);
 
+    /**
+     * @brief reuse_child_as_next_root Keeps the subtree of the given move with all its visits and statistics as the root of the next search.
+     * This is the reuse path for self play in which the same agent plays both sides, so the position after the selected move is always
+     * the next one to be searched. In contrast to apply_move_to_tree() this also works after the full tree has been reused.
+     * @param move Move which was selected at the current root
+     */
+    void reuse_child_as_next_root(Move move);
+
     /**
      * @brief clear_game_history Traverses all root positions for the game and calls clear_subtree() for each of them
      */
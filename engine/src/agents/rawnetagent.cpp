@@ -56,6 +56,8 @@ void RawNetAgent::evaluate_board_state(Board *pos, EvalInfo& evalInfo)
           // a value of 0 is likely a wron evaluation but won't be written to stdout
         evalInfo.centipawns = value_to_centipawn(0);
         evalInfo.depth = 0;
+        evalInfo.selDepth = 0;
+        evalInfo.hashFull = 0;
         evalInfo.nodes = 0;
         evalInfo.pv = {evalInfo.legalMoves[0]};
         return;
@@ -77,6 +79,8 @@ void RawNetAgent::evaluate_board_state(Board *pos, EvalInfo& evalInfo)
 
     evalInfo.centipawns = value_to_centipawn(value);
     evalInfo.depth = 1;
+    evalInfo.selDepth = 1;
+    evalInfo.hashFull = 0;
     evalInfo.nodes = 1;
     evalInfo.isChess960 = pos->is_chess960();
     evalInfo.pv = { bestmove };
@@ -43,6 +43,8 @@
 #include "optionsuci.h"
 #include "tests/benchmarkpositions.h"
 #include "util/communication.h"
+#include "nn/mockneuralnetapi.h"
+#include "manager/dynamictimemanager.h"
 
 using namespace std;
 
@@ -142,6 +144,17 @@ void CrazyAra::uci_loop(int argc, char *argv[])
         token.clear(); // Avoid a stale if getline() returns empty or blank line
         is >> skipws >> token;
 
+        if (token != "quit" && token != "stop" && token != "ponderhit" && token != "isready") {
+            if (searchInfinite || searchPonder) {
+                // waiting would block the loop and the required "stop" could never be read
+                stop_search();
+            }
+            else {
+                // all other commands have to wait until a running search has finished
+                wait_for_search();
+            }
+        }
+
 		if (token == "quit") {
 			break;
 		}
@@ -151,7 +164,9 @@ void CrazyAra::uci_loop(int argc, char *argv[])
 				<< "uciok" << endl;
 		}
         else if (token == "setoption")  OptionsUCI::setoption(is);
-        else if (token == "go")         go(&pos, is, evalInfo);
+        else if (token == "go")         go_async(&pos, is, evalInfo);
+        else if (token == "stop")       stop_search();
+        else if (token == "ponderhit")  { if (networkLoaded) mctsAgent->ponder_hit(); searchPonder = false; }
         else if (token == "position")   position(&pos, is);
         else if (token == "ucinewgame") new_game();
         else if (token == "isready") {
@@ -162,7 +177,10 @@ void CrazyAra::uci_loop(int argc, char *argv[])
 
         // Additional custom non-UCI commands, mainly for debugging
         else if (token == "benchmark")  benchmark(is);
+        else if (token == "mockbench")  mockbench(is);
+        else if (token == "tmsim")      tmsim(is);
         else if (token == "root")       mctsAgent->print_root_node();
+        else if (token == "treestats")  mctsAgent->print_tree_statistics();
         else if (token == "flip")       pos.flip();
         else if (token == "d")          cout << pos << endl;
 #ifdef USE_RL
@@ -174,6 +192,53 @@ void CrazyAra::uci_loop(int argc, char *argv[])
 
         ++it;
     } while (token != "quit" && argc == 1); // Command line args are one-shot
+
+    if (token == "quit") {
+        stop_search();
+    }
+    else {
+        wait_for_search();
+    }
+}
+
+void CrazyAra::go_async(Board *pos, istringstream &is, EvalInfo &evalInfo)
+{
+    if (!is_ready()) {
+        return;
+    }
+    string goArguments;
+    getline(is, goArguments);
+    istringstream isArguments(goArguments);
+    string token;
+    while (isArguments >> token) {
+        searchInfinite |= token == "infinite";
+        searchPonder |= token == "ponder";
+    }
+    // the requests are cleared before the thread is started, so that an immediate "stop" can't get lost
+    mctsAgent->clear_search_requests();
+    mainSearchThread = thread([this, pos, goArguments, &evalInfo]{
+        istringstream isGo(goArguments);
+        go(pos, isGo, evalInfo);
+    });
+}
+
+void CrazyAra::wait_for_search()
+{
+    if (mainSearchThread.joinable()) {
+        mainSearchThread.join();
+    }
+    searchInfinite = false;
+    searchPonder = false;
+}
+
+void CrazyAra::stop_search()
+{
+    if (mainSearchThread.joinable()) {
+        mctsAgent->request_stop();
+        mainSearchThread.join();
+    }
+    searchInfinite = false;
+    searchPonder = false;
 }
 
 void CrazyAra::go(Board *pos, istringstream &is,  EvalInfo& evalInfo, bool applyMoveToTree) {
@@ -200,6 +265,8 @@ void CrazyAra::go(Board *pos, istringstream &is,  EvalInfo& evalInfo, bool apply
         else if (token == "infinite")  searchLimits.infinite = true;
         else if (token == "ponder")    ponderMode = true;
     }
+    // the search runs without a time limit until a "ponderhit" or "stop" is received
+    searchLimits.ponder = ponderMode;
     //  EvalInfo res = rawAgent->evalute_board_state(pos);
     //  rawAgent->perform_action(pos);
     mctsAgent->perform_action(pos, &searchLimits, evalInfo);
@@ -309,6 +376,131 @@ void CrazyAra::benchmark(istringstream &is)
     cout << "PV-Depth:\t" << setw(2) << totalDepth /  benchmark.positions.size() << endl;
 }
 
+void CrazyAra::mockbench(istringstream &is)
+{
+    size_t nodes = 10000;
+    size_t latencyMicros = 0;
+    string policyName = "hash";
+    is >> nodes >> latencyMicros >> policyName;
+    const MockPolicyType policyType = policyName == "uniform" ? MOCK_UNIFORM : MOCK_HASH_SEEDED;
+
+    if (!networkLoaded) {
+        // the settings and move look-up tables are usually initialized when loading the network
+        delete searchSettings;
+        delete playSettings;
+        init_search_settings();
+        init_play_settings();
+        Constants::init(false);
+    }
+    const bool isPolicyMap = networkLoaded && mctsAgent->is_policy_map();
+
+    // the search must only be limited by the node count and mustn't be randomized
+    const bool allowEarlyStopping = searchSettings->allowEarlyStopping;
+    const float dirichletEpsilon = searchSettings->dirichletEpsilon;
+    searchSettings->allowEarlyStopping = false;
+    searchSettings->dirichletEpsilon = 0.0f;
+
+    MockNeuralNetAPI* mockNetSingle = new MockNeuralNetAPI(1, isPolicyMap, policyType, latencyMicros);
+    vector<MockNeuralNetAPI*> mockNetBatches;
+    NeuralNetAPI** netBatches = new NeuralNetAPI*[size_t(searchSettings->threads)];
+    for (size_t i = 0; i < size_t(searchSettings->threads); ++i) {
+        mockNetBatches.push_back(new MockNeuralNetAPI(searchSettings->batchSize, isPolicyMap, policyType, latencyMicros));
+        netBatches[i] = mockNetBatches.back();
+    }
+    StatesManager mockStates;
+    MCTSAgent* mockAgent = create_new_mcts_agent(mockNetSingle, netBatches, &mockStates);
+
+    BenchmarkPositions benchmark;
+    Variant variant = UCI::variant_from_name(Options["UCI_Variant"]);
+    auto uiThread = make_shared<Thread>(0);
+    size_t totalNodes = 0;
+    size_t totalExpansions = 0;
+    size_t totalAllocations = 0;
+    size_t totalMicros = 0;
+
+    for (const TestPosition& testPos : benchmark.positions) {
+        Board pos;
+        pos.set(testPos.fen, false, variant, new StateInfo, uiThread.get());
+        SearchLimits searchLimits;
+        searchLimits.nodes = nodes;
+        searchLimits.startTime = now();
+        EvalInfo evalInfo;
+
+        const auto startTime = chrono::steady_clock::now();
+        mockAgent->perform_action(&pos, &searchLimits, evalInfo);
+        totalMicros += size_t(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - startTime).count());
+        totalNodes += evalInfo.nodes - evalInfo.nodesPreSearch;
+        totalExpansions += mockAgent->get_number_expansions();
+        totalAllocations += mockAgent->get_number_allocations();
+        mockAgent->clear_game_history();
+    }
+
+    // the search threads run their inference concurrently, so the average inference time per thread is subtracted
+    size_t inferenceMicros = 0;
+    size_t numberPredictions = 0;
+    for (const MockNeuralNetAPI* mockNet : mockNetBatches) {
+        inferenceMicros += mockNet->get_inference_micros();
+        numberPredictions += mockNet->get_number_predictions();
+    }
+    const size_t inferenceMicrosPerThread = inferenceMicros / mockNetBatches.size();
+    const size_t treeMicros = totalMicros > inferenceMicrosPerThread ? totalMicros - inferenceMicrosPerThread : 1;
+
+    cout << endl << "Mock benchmark summary" << endl;
+    cout << "----------------------" << endl;
+    cout << "Positions:\t\t" << benchmark.positions.size() << endl;
+    cout << "Policy type:\t\t" << mockNetSingle->get_model_name() << endl;
+    cout << "Latency (us):\t\t" << latencyMicros << endl;
+    cout << "Threads:\t\t" << searchSettings->threads << endl;
+    cout << "Nodes:\t\t\t" << totalNodes << endl;
+    cout << "Time (ms):\t\t" << totalMicros / 1000 << endl;
+    cout << "NPS:\t\t\t" << size_t(totalNodes / (totalMicros / 1e6) + 0.5) << endl;
+    cout << "Tree-only NPS:\t\t" << size_t(totalNodes / (treeMicros / 1e6) + 0.5) << endl;
+    cout << "NN calls:\t\t" << numberPredictions << endl;
+    cout << "Inference (ms):\t\t" << inferenceMicrosPerThread / 1000 << endl;
+    cout << "Tree (ms):\t\t" << treeMicros / 1000 << endl;
+    if (totalExpansions != 0) {
+        cout << "Allocs/expansion:\t" << float(totalAllocations) / totalExpansions << endl;
+    }
+
+    searchSettings->allowEarlyStopping = allowEarlyStopping;
+    searchSettings->dirichletEpsilon = dirichletEpsilon;
+    delete mockAgent;
+    delete mockNetSingle;
+}
+
+void CrazyAra::tmsim(istringstream &is)
+{
+    string traceFile;
+    is >> traceFile;
+    vector<SearchTrace> traces;
+    if (!read_search_traces(traceFile, traces)) {
+        info_string("Couldn't read the search traces of", traceFile);
+        return;
+    }
+
+    DynamicTimeSettings settings;
+    string name;
+    float value;
+    while (is >> name >> value) {
+        if (name == "minTimeFactor")         settings.minTimeFactor = value;
+        else if (name == "stopVisitShare")   settings.stopVisitShare = value;
+        else if (name == "stopQGap")         settings.stopQGap = value;
+        else if (name == "stabilityFactor")  settings.stabilityFactor = value;
+        else if (name == "extendQGap")       settings.extendQGap = value;
+        else if (name == "maxTimeFactor")    settings.maxTimeFactor = value;
+        else info_string("Unknown time manager setting", name);
+    }
+    const TimeSimulationResult result = simulate_time_manager(traces, settings);
+
+    cout << endl << "Time manager simulation summary" << endl;
+    cout << "-------------------------------" << endl;
+    cout << "Searches:		" << result.numberSearches << endl;
+    cout << "Time ratio (avg):	" << result.avgTimeRatio << endl;
+    cout << "Best move agreement:	" << result.agreement << endl;
+    cout << "Early stops:		" << result.earlyStops << endl;
+    cout << "Extensions:		" << result.extensions << endl;
+}
+
 #ifdef USE_RL
 void CrazyAra::selfplay(istringstream &is)
 {
@@ -317,32 +509,168 @@ void CrazyAra::selfplay(istringstream &is)
     SelfPlay selfPlay(rawAgent, mctsAgent, &searchLimits, playSettings, rlSettings);
     size_t numberOfGames;
     is >> numberOfGames;
-    selfPlay.go(numberOfGames, states);
+
+    NeuralNetAPI* poolNet = nullptr;
+    OpeningPool* openingPool = nullptr;
+    if (rlSettings->openingPoolSize > 0) {
+#ifdef TENSORRT
+        const bool useTensorRT = bool(Options["Use_TensorRT"]);
+#else
+        const bool useTensorRT = false;
+#endif
+        // the pool has its own network, so it can be refilled while the games are searched
+        poolNet = new NeuralNetAPI(Options["Context"], int(Options["Device_ID"]), unsigned(rlSettings->openingPoolBatchSize),
+                                   Options["Model_Directory"], useTensorRT);
+        openingPool = new OpeningPool(poolNet, rlSettings->openingPoolBatchSize, CRAZYHOUSE_VARIANT, playSettings,
+                                      rlSettings->rawPolicyProbabilityTemperature, rlSettings->openingPoolSize,
+                                      rlSettings->openingPoolRefill, string("openings_") + mctsAgent->get_device_name() + string(".txt"));
+        openingPool->fill();
+        selfPlay.set_opening_pool(openingPool);
+    }
+
+    if (rlSettings->numberParallelGames > 1) {
+        selfplay_parallel(selfPlay, numberOfGames, searchLimits);
+    }
+    else {
+        selfPlay.go(numberOfGames, states);
+    }
+    delete openingPool;
+    delete poolNet;
     cout << "readyok" << endl;
 }
 
+void CrazyAra::selfplay_parallel(SelfPlay& selfPlay, size_t numberOfGames, const SearchLimits& searchLimits)
+{
+#ifdef TENSORRT
+    const bool useTensorRT = bool(Options["Use_TensorRT"]);
+#else
+    const bool useTensorRT = false;
+#endif
+    const size_t numberGames = rlSettings->numberParallelGames;
+    // every game needs a slot for its root node evaluation and a slot for the mini-batch of each search thread
+    const size_t gameBatchSize = 1 + searchSettings->threads * searchSettings->batchSize;
+    NeuralNetAPI* net = new NeuralNetAPI(Options["Context"], int(Options["Device_ID"]), unsigned(numberGames * gameBatchSize),
+                                         Options["Model_Directory"], useTensorRT);
+    BatchDispatcher dispatcher(net, numberGames * gameBatchSize, chrono::microseconds(rlSettings->dispatcherFlushMicros));
+
+    vector<SelfPlayWorker*> workers;
+    vector<NeuralNetAPI*> gameNetSingles;
+    vector<SearchSettings*> gameSearchSettings;
+    for (size_t gameIdx = 0; gameIdx < numberGames; ++gameIdx) {
+        const string deviceName = net->get_device_name() + "_game" + to_string(gameIdx);
+        NeuralNetAPI* gameNetSingle = new DispatchedNeuralNetAPI(&dispatcher, 1, deviceName);
+        NeuralNetAPI** gameNetBatches = new NeuralNetAPI*[size_t(searchSettings->threads)];
+        for (size_t i = 0; i < size_t(searchSettings->threads); ++i) {
+            gameNetBatches[i] = new DispatchedNeuralNetAPI(&dispatcher, searchSettings->batchSize, deviceName);
+        }
+        // quick searches modify the search settings, so every game needs its own copy
+        SearchSettings* gameSettings = new SearchSettings(*searchSettings);
+        StatesManager* gameStates = new StatesManager();
+        MCTSAgent* gameAgent = new MCTSAgent(gameNetSingle, gameNetBatches, gameSettings, playSettings, gameStates);
+        RawNetAgent* gameRawAgent = new RawNetAgent(gameNetSingle, playSettings, false);
+        workers.push_back(new SelfPlayWorker(gameRawAgent, gameAgent, new SearchLimits(searchLimits), gameStates, searchSettings->threads));
+        gameNetSingles.push_back(gameNetSingle);
+        gameSearchSettings.push_back(gameSettings);
+    }
+
+    selfPlay.go_parallel(numberOfGames, workers, &dispatcher);
+
+    for (size_t gameIdx = 0; gameIdx < numberGames; ++gameIdx) {
+        delete workers[gameIdx]->mctsAgent;
+        delete workers[gameIdx]->rawAgent;
+        delete workers[gameIdx]->searchLimits;
+        delete workers[gameIdx]->states;
+        delete workers[gameIdx];
+        delete gameNetSingles[gameIdx];
+        delete gameSearchSettings[gameIdx];
+    }
+    delete net;
+}
+
 void CrazyAra::arena(istringstream &is)
 {
     SearchLimits searchLimits;
     searchLimits.nodes = size_t(Options["Nodes"]);
     SelfPlay selfPlay(rawAgent, mctsAgent, &searchLimits, playSettings, rlSettings);
-    NeuralNetAPI* netSingle = create_new_net_single(Options["Model_Directory_Contender"]);
-    NeuralNetAPI** netBatches = create_new_net_batches(Options["Model_Directory_Contender"]);
-    MCTSAgent* mctsAgentContender = create_new_mcts_agent(netSingle, netBatches, states);
     size_t numberOfGames;
     is >> numberOfGames;
-    TournamentResult tournamentResult = selfPlay.go_arena(mctsAgentContender, numberOfGames, states);
+    TournamentResult tournamentResult;
+    if (rlSettings->numberParallelGames > 1) {
+        tournamentResult = arena_parallel(selfPlay, numberOfGames, searchLimits);
+    }
+    else {
+        NeuralNetAPI* netSingle = create_new_net_single(Options["Model_Directory_Contender"]);
+        NeuralNetAPI** netBatches = create_new_net_batches(Options["Model_Directory_Contender"]);
+        MCTSAgent* mctsAgentContender = create_new_mcts_agent(netSingle, netBatches, states);
+        tournamentResult = selfPlay.go_arena(mctsAgentContender, numberOfGames, states);
+        delete mctsAgentContender;
+        delete netSingle;
+    }
     cout << "Arena summary" << endl;
     cout << "Score of Contender vs Producer: " << tournamentResult << endl;
-    if (tournamentResult.score() > 0.5f) {
+    const SPRTDecision decision = rlSettings->arenaSPRT ? tournamentResult.sprt(rlSettings->sprtElo0, rlSettings->sprtElo1,
+                                                                               rlSettings->sprtAlpha, rlSettings->sprtBeta) : SPRT_CONTINUE;
+    if (decision == SPRT_ACCEPT_H1 || (decision == SPRT_CONTINUE && tournamentResult.score() > 0.5f)) {
         cout << "replace" << endl;
     }
     else {
         cout << "keep" << endl;
     }
     write_tournament_result_to_csv(tournamentResult, "arena_results.csv");
-    delete mctsAgentContender;
-    delete netSingle;
+}
+
+TournamentResult CrazyAra::arena_parallel(SelfPlay& selfPlay, size_t numberOfGames, const SearchLimits& searchLimits)
+{
+#ifdef TENSORRT
+    const bool useTensorRT = bool(Options["Use_TensorRT"]);
+#else
+    const bool useTensorRT = false;
+#endif
+    const size_t numberGames = rlSettings->numberParallelGames;
+    const size_t gameBatchSize = 1 + searchSettings->threads * searchSettings->batchSize;
+    // only one of both agents of a game searches at a time, but the producer and contender moves of different games overlap
+    NeuralNetAPI* producerNet = new NeuralNetAPI(Options["Context"], int(Options["Device_ID"]), unsigned(numberGames * gameBatchSize),
+                                                 Options["Model_Directory"], useTensorRT);
+    NeuralNetAPI* contenderNet = new NeuralNetAPI(Options["Context"], int(Options["Device_ID"]), unsigned(numberGames * gameBatchSize),
+                                                  Options["Model_Directory_Contender"], useTensorRT);
+    BatchDispatcher producerDispatcher(producerNet, numberGames * gameBatchSize, chrono::microseconds(rlSettings->dispatcherFlushMicros));
+    BatchDispatcher contenderDispatcher(contenderNet, numberGames * gameBatchSize, chrono::microseconds(rlSettings->dispatcherFlushMicros));
+
+    vector<ArenaWorker*> workers;
+    vector<NeuralNetAPI*> gameNetSingles;
+    for (size_t gameIdx = 0; gameIdx < numberGames; ++gameIdx) {
+        StatesManager* gameStates = new StatesManager();
+        MCTSAgent* agents[2];
+        BatchDispatcher* dispatchers[2] = {&producerDispatcher, &contenderDispatcher};
+        NeuralNetAPI* nets[2] = {producerNet, contenderNet};
+        for (size_t agentIdx = 0; agentIdx < 2; ++agentIdx) {
+            const string deviceName = nets[agentIdx]->get_device_name() + "_game" + to_string(gameIdx);
+            NeuralNetAPI* gameNetSingle = new DispatchedNeuralNetAPI(dispatchers[agentIdx], 1, deviceName);
+            NeuralNetAPI** gameNetBatches = new NeuralNetAPI*[size_t(searchSettings->threads)];
+            for (size_t i = 0; i < size_t(searchSettings->threads); ++i) {
+                gameNetBatches[i] = new DispatchedNeuralNetAPI(dispatchers[agentIdx], searchSettings->batchSize, deviceName);
+            }
+            agents[agentIdx] = new MCTSAgent(gameNetSingle, gameNetBatches, searchSettings, playSettings, gameStates);
+            gameNetSingles.push_back(gameNetSingle);
+        }
+        workers.push_back(new ArenaWorker(agents[0], agents[1], new SearchLimits(searchLimits), gameStates, searchSettings->threads));
+    }
+
+    TournamentResult tournamentResult = selfPlay.go_arena_parallel(numberOfGames, workers, &producerDispatcher, &contenderDispatcher);
+
+    for (ArenaWorker* worker : workers) {
+        delete worker->producer;
+        delete worker->contender;
+        delete worker->searchLimits;
+        delete worker->states;
+        delete worker;
+    }
+    for (NeuralNetAPI* gameNetSingle : gameNetSingles) {
+        delete gameNetSingle;
+    }
+    delete producerNet;
+    delete contenderNet;
+    return tournamentResult;
 }
 
 void CrazyAra::init_rl_settings()
@@ -350,13 +678,29 @@ void CrazyAra::init_rl_settings()
     rlSettings = new RLSettings();
     rlSettings->numberChunks = Options["Selfplay_Number_Chunks"];
     rlSettings->chunkSize = Options["Selfplay_Chunk_Size"];
+    rlSettings->sparsePolicy = Options["Selfplay_Sparse_Policy"];
+    rlSettings->packPlanes = Options["Selfplay_Pack_Planes"];
+    rlSettings->rotateShards = Options["Selfplay_Rotate_Shards"];
+    rlSettings->resumeExport = Options["Selfplay_Resume_Export"];
+    rlSettings->reuseTree = Options["Selfplay_Reuse_Tree"];
     rlSettings->quickSearchNodes = Options["Quick_Nodes"];
     rlSettings->quickSearchProbability = Options["Centi_Quick_Probability"] / 100.0f;
     rlSettings->quickSearchQValueWeight = Options["Centi_Quick_Q_Value_Weight"] / 100.0f;
     rlSettings->lowPolicyClipThreshold = Options["Milli_Policy_Clip_Thresh"] / 1000.0f;
     rlSettings->quickDirichletEpsilon = Options["Centi_Quick_Dirichlet_Epsilon"] / 100.0f;
+    rlSettings->quickSearchSampleWeight = Options["Centi_Quick_Sample_Weight"] / 100.0f;
     rlSettings->nodeRandomFactor = Options["Centi_Node_Random_Factor"] / 100.0f;
     rlSettings->rawPolicyProbabilityTemperature = Options["Centi_Raw_Prob_Temperature"] / 100.0f;
+    rlSettings->openingPoolSize = Options["Selfplay_Opening_Pool_Size"];
+    rlSettings->openingPoolBatchSize = Options["Selfplay_Opening_Pool_Batch"];
+    rlSettings->openingPoolRefill = Options["Selfplay_Opening_Pool_Refill"];
+    rlSettings->numberParallelGames = Options["Selfplay_Parallel_Games"];
+    rlSettings->dispatcherFlushMicros = Options["Selfplay_Flush_Timeout"];
+    rlSettings->arenaSPRT = Options["Arena_SPRT"];
+    rlSettings->sprtElo0 = Options["Arena_SPRT_Elo0"];
+    rlSettings->sprtElo1 = Options["Arena_SPRT_Elo1"];
+    rlSettings->sprtAlpha = Options["Centi_Arena_SPRT_Alpha"] / 100.0f;
+    rlSettings->sprtBeta = Options["Centi_Arena_SPRT_Beta"] / 100.0f;
 }
 #endif
 
@@ -372,6 +716,9 @@ void CrazyAra::init()
 bool CrazyAra::is_ready()
 {
     if (!networkLoaded) {
+        // the settings might have been created before by a mock benchmark
+        delete searchSettings;
+        delete playSettings;
         init_search_settings();
         init_play_settings();
 #ifdef USE_RL
@@ -429,8 +776,10 @@ void CrazyAra::init_search_settings()
 {
     searchSettings = new SearchSettings();
     searchSettings->threads = Options["Threads"];
+    searchSettings->postProcessingThreads = Options["Post_Processing_Threads"];
     searchSettings->batchSize = Options["Batch_Size"];
     searchSettings->useTranspositionTable = Options["Use_Transposition_Table"];
+    searchSettings->reconstructPositions = Options["Reconstruct_Positions"];
 //    searchSettings->uInit = float(Options["Centi_U_Init_Divisor"]) / 100.0f;     currently disabled
 //    searchSettings->uMin = Options["Centi_U_Min"] / 100.0f;                      currently disabled
 //    searchSettings->uBase = Options["U_Base"];                                   currently disabled
@@ -443,11 +792,19 @@ void CrazyAra::init_search_settings()
     searchSettings->dirichletAlpha = Options["Centi_Dirichlet_Alpha"] / 100.0f;
     searchSettings->nodePolicyTemperature = Options["Centi_Node_Temperature"] / 100.0f;
     searchSettings->virtualLoss = Options["Virtual_Loss"];
+    searchSettings->adaptiveVirtualLoss = Options["Adaptive_Virtual_Loss"];
+    searchSettings->multiVisitCollisions = Options["Multi_Visit_Collisions"];
+    searchSettings->allocationStatistics = Options["Allocation_Statistics"];
     searchSettings->qThreshInit = Options["Centi_Q_Thresh_Init"] / 100.0f;
     searchSettings->qThreshMax = Options["Centi_Q_Thresh_Max"] / 100.0f;
     searchSettings->qThreshBase = Options["Q_Thresh_Base"];
     searchSettings->randomMoveFactor = Options["Centi_Random_Move_Factor"]  / 100.0f;
     searchSettings->allowEarlyStopping = Options["Allow_Early_Stopping"];
+    searchSettings->infoIntervalMS = Options["Info_Interval"];
+    searchSettings->hashFullNodes = Options["Hash_Full_Nodes"];
+    searchSettings->multiPV = Options["MultiPV"];
+    searchSettings->dynamicTimeManager = Options["Dynamic_Time_Manager"];
+    searchSettings->timeTraceFile = string(Options["Time_Trace_File"]);
 }
 
 void CrazyAra::init_play_settings()
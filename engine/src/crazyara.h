@@ -29,6 +29,7 @@
 #define CRAZYARA_H
 
 #include <iostream>
+#include <thread>
 
 #include "agents/rawnetagent.h"
 #include "agents/mctsagent.h"
@@ -73,6 +74,11 @@ private:
     PlaySettings* playSettings;
     bool networkLoaded = false;
     StatesManager* states;
+    // runs the search of a "go" command, so that the UCI loop can keep reading commands
+    thread mainSearchThread;
+    // the running search only ends with a "stop" (infinite) or a "ponderhit" or "stop" (ponder)
+    bool searchInfinite = false;
+    bool searchPonder = false;
 
 #ifdef USE_RL
     MCTSAgent* mctsAgentContender;
@@ -157,6 +163,24 @@ public:
      */
     void go(const string& fen, string goCommand, EvalInfo& evalInfo);
 
+    /**
+     * @brief go_async Starts the search for a "go" command on a dedicated thread and returns immediately
+     * @param pos Current board position, which mustn't be changed until the search has finished
+     * @param is List of command line arguments for the search
+     * @param evalInfo Returns the evalutation information
+     */
+    void go_async(Board* pos, istringstream& is, EvalInfo& evalInfo);
+
+    /**
+     * @brief wait_for_search Blocks until a running search has finished by itself
+     */
+    void wait_for_search();
+
+    /**
+     * @brief stop_search Stops a running search (or pondering) and waits until its best move has been sent
+     */
+    void stop_search();
+
     /**
      * @brief position Method which is called from the UCI command-line when a new position is described.
      * This can be a FEN string or the starting position followed by a list of moves
@@ -171,6 +195,19 @@ public:
      */
     void benchmark(istringstream& is);
 
+    /**
+     * @brief mockbench Runs the benchmark positions for a fixed number of nodes with a mock network instead of a loaded model.
+     * This measures the performance of the search itself and is reproducible when using a single thread.
+     * @param is Number of nodes per position, synthetic latency per NN call in microseconds and the policy type ("uniform" or "hash")
+     */
+    void mockbench(istringstream& is);
+
+    /**
+     * @brief tmsim Replays the search traces of a Time_Trace_File with the dynamic time manager and prints the resulting time usage.
+     * @param is Trace file followed by optional pairs of a DynamicTimeSettings member and its value (e.g. "traces.txt stopVisitShare 0.7")
+     */
+    void tmsim(istringstream& is);
+
 #ifdef USE_RL
     /**
      * @brief selfplay Starts self play for a given number of games
@@ -178,6 +215,15 @@ public:
      */
     void selfplay(istringstream &is);
 
+    /**
+     * @brief selfplay_parallel Generates rlSettings->numberParallelGames games concurrently. Every game has its own search tree
+     * and the inference requests of all games are pooled into large batches for a single network instance.
+     * @param selfPlay Self play object which exports the games and training samples
+     * @param numberOfGames Number of games to generate (0 generates games until the export file is full)
+     * @param searchLimits Search limits which are copied for every game
+     */
+    void selfplay_parallel(SelfPlay& selfPlay, size_t numberOfGames, const SearchLimits& searchLimits);
+
     /**
      * @brief arena Starts the arena comparision between two different NN weights.
      * The score can be used for logging and to decide if the current weights shall be replaced.
@@ -188,6 +234,16 @@ public:
      */
     void arena(istringstream &is);
 
+    /**
+     * @brief arena_parallel Plays the arena games with rlSettings->numberParallelGames concurrent games.
+     * All producer agents share one network and all contender agents share another one.
+     * @param selfPlay Self play object holding the producer agent
+     * @param numberOfGames Maximum number of games
+     * @param searchLimits Search limits which are copied for every game
+     * @return Tournament result in respect to the contender
+     */
+    TournamentResult arena_parallel(SelfPlay& selfPlay, size_t numberOfGames, const SearchLimits& searchLimits);
+
     /**
      * @brief init_rl_settings Initializes the rl settings used for the mcts agent with the current UCI parameters
      */
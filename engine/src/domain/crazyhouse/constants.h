@@ -4737,6 +4737,12 @@ extern std::string LABELS_MIRRORED[NB_LABELS];
 namespace Constants {
 inline void init(bool isPolicyMap) {
 
+    // the look-up tables might have been initialized before for a different policy representation
+    MV_LOOKUP.clear();
+    MV_LOOKUP_MIRRORED.clear();
+    MV_LOOKUP_CLASSIC.clear();
+    MV_LOOKUP_MIRRORED_CLASSIC.clear();
+
     // fill mirrored label list and look-up table
     for (size_t mvIdx=0; mvIdx < NB_LABELS; mvIdx++) {
         LABELS_MIRRORED[mvIdx] = mirror_move(LABELS[mvIdx]);
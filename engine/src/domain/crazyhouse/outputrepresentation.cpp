@@ -26,6 +26,7 @@
 #include "outputrepresentation.h"
 #include "types.h"
 #include "policymaprepresentation.h"
+#include "../../util/blazeutil.h"
 using namespace std;
 
 // TODO: Change this later to blaze::HybridVector<float, MAX_NB_LEGAL_MOVES>
@@ -73,6 +74,33 @@ void get_probs_of_moves(const float *data, const vector<Move>& legalMoves, unord
     }
 }
 
+void get_probs_of_moves_with_temperature(const float *data, Span<const Move> legalMoves, const unordered_map<Move, size_t>& moveLookup,
+                                         bool isPolicyMap, float temperature, DynamicVector<float> &policyProbSmall)
+{
+    assert(legalMoves.size() == policyProbSmall.size());
+    float* probs = policyProbSmall.data();
+
+    if (isPolicyMap) {
+        // the policy map output is already a probability distribution
+        for (size_t mvIdx = 0; mvIdx < legalMoves.size(); ++mvIdx) {
+            probs[mvIdx] = data[moveLookup.at(legalMoves[mvIdx])];
+        }
+        apply_temperature(policyProbSmall, temperature);
+        return;
+    }
+
+    // gather the logits and scale them by the inverse temperature: softmax(x/T) equals softmax(x)^(1/T) after renormalization
+    const float invTemperature = 1.0f / temperature;
+    float maxLogit = -FLT_MAX;
+    for (size_t mvIdx = 0; mvIdx < legalMoves.size(); ++mvIdx) {
+        probs[mvIdx] = data[moveLookup.at(legalMoves[mvIdx])] * invTemperature;
+        maxLogit = max(maxLogit, probs[mvIdx]);
+    }
+    // subtracting the maximum keeps the exponent numerically stable, both operations are evaluated in place
+    policyProbSmall = exp(policyProbSmall - maxLogit);
+    policyProbSmall *= 1.0f / sum(policyProbSmall);
+}
+
 // https://helloacm.com/how-to-implement-the-sgn-function-in-c/
 template <class T>
 inline int
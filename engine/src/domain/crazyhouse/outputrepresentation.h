@@ -32,6 +32,7 @@
 #include "mxnet-cpp/MxNetCpp.h"
 #include <blaze/Math.h>
 #include "constants.h"
+#include "util/span.h"
 
 using blaze::HybridVector;
 using blaze::DynamicVector;
@@ -74,6 +75,21 @@ void get_probs_of_move_list(const size_t batchIdx, const NDArray* policyProb, co
 void get_probs_of_moves(const float *data, const vector<Move>& legalMoves,
                         unordered_map<Move, size_t>& moveLookup, DynamicVector<float> &policyProbSmall);
 
+/**
+ * @brief get_probs_of_moves_with_temperature Fused post-processing of the raw policy output for a single position.
+ * The entries of all legal moves are gathered, the temperature is applied as a scaling inside the softmax exponent
+ * (softmax(x / temperature)) and the result is normalized in place. This replaces the separate gather, softmax and temperature passes.
+ * Policy map outputs are already probabilities, so the temperature is applied as p^(1/temperature) with a renormalization instead.
+ * @param data Pointer to the policy output of the current batch index
+ * @param legalMoves List of legal moves for the position
+ * @param moveLookup Look-up table which maps a move to its index in the policy output
+ * @param isPolicyMap Sets if the policy is encoded in policy map representation
+ * @param temperature Temperature value (should be non-zero positive value)
+ * @param policyProbSmall Output vector which must already have the same size as legalMoves
+ */
+void get_probs_of_moves_with_temperature(const float *data, Span<const Move> legalMoves, const unordered_map<Move, size_t>& moveLookup,
+                                         bool isPolicyMap, float temperature, DynamicVector<float> &policyProbSmall);
+
 /**
  * @brief value_to_centipawn Converts a value in A0-notation to roughly a centi-pawn loss
  * @param value floating value from [-1.,1.]
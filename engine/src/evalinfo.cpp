@@ -30,9 +30,11 @@ std::ostream& operator<<(std::ostream& os, const EvalInfo& evalInfo)
 {
     os << "cp " << evalInfo.centipawns
        << " depth " << evalInfo.depth
+       << " seldepth " << evalInfo.selDepth
        << " nodes " << evalInfo.nodes
        << " time " << evalInfo.elapsedTimeMS
        << " nps " << evalInfo.nps
+       << " hashfull " << evalInfo.hashFull
        << " pv";
     for (Move move: evalInfo.pv) {
         os << " " << UCI::move(move, evalInfo.isChess960);
@@ -46,6 +46,8 @@ struct EvalInfo
     DynamicVector<float> childNumberVisits;
     int centipawns;
     size_t depth;
+    size_t selDepth;
+    int hashFull;
     size_t nodes;
     size_t nodesPreSearch;
     float elapsedTimeMS;
@@ -0,0 +1,153 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: dynamictimemanager.cpp
+ * Created on 19.10.2026
+ * @author: queensgambit
+ */
+
+#include "dynamictimemanager.h"
+#include <fstream>
+#include <limits>
+#include <algorithm>
+
+DynamicTimeSettings::DynamicTimeSettings():
+    minTimeFactor(0.3f),
+    stopVisitShare(0.8f),
+    stopQGap(0.1f),
+    stabilityFactor(0.25f),
+    extendQGap(0.03f),
+    maxTimeFactor(2.0f)
+{
+}
+
+DynamicTimeManager::DynamicTimeManager(const DynamicTimeSettings& settings):
+    settings(settings),
+    movetime(0),
+    hardCapMS(0),
+    lastBestIdx(numeric_limits<size_t>::max()),
+    lastBestChangeMS(0)
+{
+}
+
+void DynamicTimeManager::start(int movetime, int maxTimeMS)
+{
+    this->movetime = movetime;
+    hardCapMS = min(maxTimeMS, int(movetime * settings.maxTimeFactor));
+    lastBestIdx = numeric_limits<size_t>::max();
+    lastBestChangeMS = 0;
+}
+
+bool DynamicTimeManager::should_stop(const RootSnapshot& snapshot)
+{
+    if (snapshot.bestIdx != lastBestIdx) {
+        lastBestIdx = snapshot.bestIdx;
+        lastBestChangeMS = snapshot.elapsedMS;
+    }
+    if (snapshot.elapsedMS >= hardCapMS) {
+        return true;
+    }
+    const bool isStable = snapshot.elapsedMS - lastBestChangeMS >= settings.stabilityFactor * movetime;
+    if (snapshot.elapsedMS >= settings.minTimeFactor * movetime && isStable &&
+            snapshot.bestVisitShare >= settings.stopVisitShare && snapshot.qGap >= settings.stopQGap) {
+        return true;
+    }
+    if (snapshot.elapsedMS < movetime) {
+        return false;
+    }
+    // extend the search as long as the decision between the best moves isn't settled yet
+    return isStable && snapshot.qGap >= settings.extendQGap;
+}
+
+int DynamicTimeManager::get_hard_cap() const
+{
+    return hardCapMS;
+}
+
+void write_search_trace(ostream& os, const SearchTrace& trace)
+{
+    os << "search " << trace.movetime << " " << trace.maxTimeMS << " " << trace.snapshots.size() << "\n";
+    for (const RootSnapshot& snapshot : trace.snapshots) {
+        os << snapshot.elapsedMS << " " << snapshot.bestIdx << " " << snapshot.bestVisitShare << " " << snapshot.qGap << "\n";
+    }
+    os.flush();
+}
+
+bool read_search_traces(const string& filename, vector<SearchTrace>& traces)
+{
+    ifstream is(filename);
+    if (!is.is_open()) {
+        return false;
+    }
+    string token;
+    while (is >> token) {
+        if (token != "search") {
+            return false;
+        }
+        SearchTrace trace;
+        size_t numberSnapshots;
+        if (!(is >> trace.movetime >> trace.maxTimeMS >> numberSnapshots)) {
+            return false;
+        }
+        trace.snapshots.resize(numberSnapshots);
+        for (RootSnapshot& snapshot : trace.snapshots) {
+            if (!(is >> snapshot.elapsedMS >> snapshot.bestIdx >> snapshot.bestVisitShare >> snapshot.qGap)) {
+                return false;
+            }
+        }
+        traces.push_back(trace);
+    }
+    return true;
+}
+
+TimeSimulationResult simulate_time_manager(const vector<SearchTrace>& traces, const DynamicTimeSettings& settings)
+{
+    TimeSimulationResult result;
+    result.numberSearches = 0;
+    result.avgTimeRatio = 0;
+    result.agreement = 0;
+    result.earlyStops = 0;
+    result.extensions = 0;
+
+    DynamicTimeManager timeManager(settings);
+    for (const SearchTrace& trace : traces) {
+        if (trace.snapshots.empty() || trace.movetime <= 0) {
+            continue;
+        }
+        timeManager.start(trace.movetime, trace.maxTimeMS);
+        const RootSnapshot* stopSnapshot = &trace.snapshots.back();
+        for (const RootSnapshot& snapshot : trace.snapshots) {
+            if (timeManager.should_stop(snapshot)) {
+                stopSnapshot = &snapshot;
+                break;
+            }
+        }
+        ++result.numberSearches;
+        result.avgTimeRatio += float(stopSnapshot->elapsedMS) / trace.movetime;
+        result.agreement += stopSnapshot->bestIdx == trace.snapshots.back().bestIdx;
+        result.earlyStops += stopSnapshot->elapsedMS < trace.movetime;
+        result.extensions += stopSnapshot->elapsedMS > trace.movetime;
+    }
+    if (result.numberSearches != 0) {
+        result.avgTimeRatio /= result.numberSearches;
+        result.agreement /= result.numberSearches;
+    }
+    return result;
+}
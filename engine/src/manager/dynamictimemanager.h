@@ -0,0 +1,140 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: dynamictimemanager.h
+ * Created on 19.10.2026
+ * @author: queensgambit
+ *
+ * Adapts the movetime of the TimeManager during the search based on live statistics of the root node.
+ * The decisions only depend on a sequence of RootSnapshots, so recorded search traces can be replayed offline
+ * by simulate_time_manager() to tune the parameters without playing games.
+ */
+
+#ifndef DYNAMICTIMEMANAGER_H
+#define DYNAMICTIMEMANAGER_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+struct DynamicTimeSettings
+{
+    // portion of the movetime which is always used before the search can be stopped early
+    float minTimeFactor;
+    // visit share of the best move which is required for stopping early
+    float stopVisitShare;
+    // Q-value advantage of the best move over the runner-up which is required for stopping early
+    float stopQGap;
+    // the best move must not have changed during this portion of the movetime for stopping early
+    float stabilityFactor;
+    // the search is extended beyond the movetime if the Q-value advantage of the best move is below this value
+    float extendQGap;
+    // hard cap for the movetime as a multiple of the planned movetime
+    float maxTimeFactor;
+
+    DynamicTimeSettings();
+};
+
+struct RootSnapshot
+{
+    int elapsedMS;
+    // index of the most visited root move
+    size_t bestIdx;
+    // visits of the best move relative to all root child visits
+    float bestVisitShare;
+    // Q-value of the best move minus the Q-value of the second most visited move
+    float qGap;
+};
+
+struct SearchTrace
+{
+    int movetime;
+    int maxTimeMS;
+    vector<RootSnapshot> snapshots;
+};
+
+class DynamicTimeManager
+{
+private:
+    DynamicTimeSettings settings;
+    int movetime;
+    int hardCapMS;
+    size_t lastBestIdx;
+    int lastBestChangeMS;
+
+public:
+    DynamicTimeManager(const DynamicTimeSettings& settings = DynamicTimeSettings());
+
+    /**
+     * @brief start Resets the state for a new search
+     * @param movetime Planned movetime in ms of the TimeManager
+     * @param maxTimeMS Maximum time in ms which the clock allows for this move (see TimeManager::get_max_time_for_move()).
+     * The hard cap of the search is the minimum of maxTimeMS and movetime * maxTimeFactor.
+     */
+    void start(int movetime, int maxTimeMS);
+
+    /**
+     * @brief should_stop Decides if the search should be stopped based on the current root statistics.
+     * The search is stopped early if the best move is stable and clearly ahead, it is extended beyond the movetime
+     * as long as the best move changed recently or its Q-value advantage is small and it is always stopped at the hard cap.
+     * @param snapshot Current root statistics, the snapshots must be passed in chronological order
+     * @return True, if the search should be stopped
+     */
+    bool should_stop(const RootSnapshot& snapshot);
+
+    /**
+     * @brief get_hard_cap Returns the maximum time in ms of the current search
+     */
+    int get_hard_cap() const;
+};
+
+/**
+ * @brief write_search_trace Appends a search trace to the given stream. Every trace starts with a header line
+ * "search <movetime> <maxTimeMS> <numberSnapshots>" followed by one line "<elapsedMS> <bestIdx> <bestVisitShare> <qGap>" per snapshot.
+ */
+void write_search_trace(ostream& os, const SearchTrace& trace);
+
+/**
+ * @brief read_search_traces Reads all search traces of a file which was written by write_search_trace()
+ * @return False, if the file couldn't be opened or is malformed
+ */
+bool read_search_traces(const string& filename, vector<SearchTrace>& traces);
+
+struct TimeSimulationResult
+{
+    size_t numberSearches;
+    // ratio of the used time and the planned movetime averaged over all searches
+    float avgTimeRatio;
+    // portion of the searches in which the move at the stop is the same as the best move at the end of the trace
+    float agreement;
+    size_t earlyStops;
+    size_t extensions;
+};
+
+/**
+ * @brief simulate_time_manager Replays recorded search traces with the given settings.
+ * The traces should be recorded with long searches (e.g. without early stopping), because the best move at the end of each trace
+ * serves as the reference move and the time manager can't be simulated beyond the end of a trace.
+ */
+TimeSimulationResult simulate_time_manager(const vector<SearchTrace>& traces, const DynamicTimeSettings& settings);
+
+#endif // DYNAMICTIMEMANAGER_H
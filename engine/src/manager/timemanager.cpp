@@ -24,7 +24,9 @@
  */
 
 #include "timemanager.h"
+#include <algorithm>
 #include "../util/communication.h"
+#include "../util/randomgen.h"
 
 using namespace std;
 
@@ -39,8 +41,6 @@ TimeManager::TimeManager(float randomMoveFactor, int expectedGameLength, int thr
     incrementFactor(incrementFactor),
     timeBufferFactor(timeBufferFactor)
 {
-    auto seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-    srand(unsigned(int(seed)));
     assert(threshMove < expectedGameLength);
 }
 
@@ -80,6 +80,14 @@ int TimeManager::get_time_for_move(SearchLimits* searchLimits, Color me, int mov
     return apply_random_factor(curMovetime);
 }
 
+int TimeManager::get_max_time_for_move(SearchLimits* searchLimits, Color me, int curMovetime, float maxTimeShare)
+{
+    if (searchLimits->movetime != 0 || searchLimits->time[me] == 0) {
+        return curMovetime;
+    }
+    return max(curMovetime, int((searchLimits->time[me] - timeBuffer) * maxTimeShare) - searchLimits->moveOverhead);
+}
+
 int TimeManager::apply_random_factor(int curMovetime)
 {
     if (randomMoveFactor > 0) {
@@ -90,5 +98,5 @@ int TimeManager::apply_random_factor(int curMovetime)
 
 float TimeManager::get_current_random_factor()
 {
-    return (float(rand()) / RAND_MAX) * randomMoveFactor * 2 - randomMoveFactor;
+    return random_uniform(-randomMoveFactor, randomMoveFactor);
 }
@@ -80,6 +80,17 @@ public:
      * @return movetime in ms
      */
     int get_time_for_move(SearchLimits* searchLimits, Color me, int moveNumber);
+
+    /**
+     * @brief get_max_time_for_move Returns the maximum time which a dynamic extension of the movetime may use.
+     * A given fixed movetime can't be exceeded, otherwise the portion maxTimeShare of the remaining time is available.
+     * @param searchLimits Limit specification for the current position
+     * @param me Color of the current player
+     * @param curMovetime Movetime in ms which was returned by get_time_for_move()
+     * @param maxTimeShare Portion of the remaining time (excluding the time buffer) which can be used at most
+     * @return maximum movetime in ms, it's never smaller than curMovetime
+     */
+    int get_max_time_for_move(SearchLimits* searchLimits, Color me, int curMovetime, float maxTimeShare=0.2f);
 };
 
 
@@ -0,0 +1,240 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: treestatistics.cpp
+ * Created on 19.10.2026
+ * @author: queensgambit
+ */
+
+#include "treestatistics.h"
+#include <atomic>
+#include <sstream>
+#include "../util/workerpool.h"
+#include "../util/communication.h"
+
+TreeStatistics::TreeStatistics():
+    numberNodes(0),
+    expandedNodes(0),
+    leafNodes(0),
+    terminalNodes(0),
+    transpositionCopies(0),
+    nodeBytes(0),
+    boardBytes(0),
+    legalMoveBytes(0),
+    childPointerBytes(0),
+    statisticBytes(0),
+    hashTableSize(0),
+    hashTableBuckets(0)
+{
+
+}
+
+void add_histogram(vector<size_t>& target, const vector<size_t>& source)
+{
+    if (target.size() < source.size()) {
+        target.resize(source.size(), 0);
+    }
+    for (size_t idx = 0; idx < source.size(); ++idx) {
+        target[idx] += source[idx];
+    }
+}
+
+void TreeStatistics::merge(const TreeStatistics& other)
+{
+    numberNodes += other.numberNodes;
+    expandedNodes += other.expandedNodes;
+    leafNodes += other.leafNodes;
+    terminalNodes += other.terminalNodes;
+    transpositionCopies += other.transpositionCopies;
+    add_histogram(depthHistogram, other.depthHistogram);
+    add_histogram(branchingHistogram, other.branchingHistogram);
+    nodeBytes += other.nodeBytes;
+    boardBytes += other.boardBytes;
+    legalMoveBytes += other.legalMoveBytes;
+    childPointerBytes += other.childPointerBytes;
+    statisticBytes += other.statisticBytes;
+}
+
+size_t TreeStatistics::total_bytes() const
+{
+    return nodeBytes + boardBytes + legalMoveBytes + childPointerBytes + statisticBytes;
+}
+
+void increment_histogram(vector<size_t>& histogram, size_t idx)
+{
+    if (histogram.size() <= idx) {
+        histogram.resize(idx + 1, 0);
+    }
+    ++histogram[idx];
+}
+
+size_t floor_log2(size_t value)
+{
+    size_t result = 0;
+    while (value >>= 1) {
+        ++result;
+    }
+    return result;
+}
+
+/**
+ * @brief add_node_statistics Adds the statistics of a single node without visiting its child nodes
+ * @return Number of child nodes in the tree
+ */
+size_t add_node_statistics(const Node* node, size_t depth, const unordered_map<Key, Node*>* hashTable, TreeStatistics& stats)
+{
+    ++stats.numberNodes;
+    increment_histogram(stats.depthHistogram, depth);
+    if (node->is_terminal()) {
+        ++stats.terminalNodes;
+    }
+    if (hashTable != nullptr) {
+        auto it = hashTable->find(node->hash_key());
+        if (it != hashTable->end() && it->second != node) {
+            ++stats.transpositionCopies;
+        }
+    }
+
+    stats.nodeBytes += sizeof(Node);
+    if (node->get_pos() != nullptr) {
+        stats.boardBytes += sizeof(Board) + sizeof(StateInfo);
+    }
+    stats.legalMoveBytes += node->get_legal_moves().size() * sizeof(Move);
+    stats.childPointerBytes += node->get_child_nodes().size() * sizeof(Node*);
+    stats.statisticBytes += node->get_statistic_bytes();
+
+    size_t numberExpandedChildren = 0;
+    for (const Node* childNode : node->get_child_nodes()) {
+        if (childNode != nullptr) {
+            ++numberExpandedChildren;
+        }
+    }
+    if (numberExpandedChildren == 0) {
+        ++stats.leafNodes;
+    }
+    else {
+        ++stats.expandedNodes;
+        increment_histogram(stats.branchingHistogram, floor_log2(numberExpandedChildren));
+    }
+    return numberExpandedChildren;
+}
+
+/**
+ * @brief add_subtree_statistics Walks the subtree iteratively with an explicit stack, so that deep trees can't overflow the call stack
+ */
+void add_subtree_statistics(const Node* subtreeRoot, size_t depth, const unordered_map<Key, Node*>* hashTable, TreeStatistics& stats)
+{
+    vector<pair<const Node*, size_t>> stack;
+    stack.emplace_back(subtreeRoot, depth);
+    while (!stack.empty()) {
+        const Node* node = stack.back().first;
+        const size_t nodeDepth = stack.back().second;
+        stack.pop_back();
+        if (add_node_statistics(node, nodeDepth, hashTable, stats) != 0) {
+            for (const Node* childNode : node->get_child_nodes()) {
+                if (childNode != nullptr) {
+                    stack.emplace_back(childNode, nodeDepth + 1);
+                }
+            }
+        }
+    }
+}
+
+TreeStatistics compute_tree_statistics(const Node* rootNode, const unordered_map<Key, Node*>* hashTable, size_t numberThreads)
+{
+    TreeStatistics stats;
+    if (hashTable != nullptr) {
+        stats.hashTableSize = hashTable->size();
+        stats.hashTableBuckets = hashTable->bucket_count();
+    }
+    if (rootNode == nullptr) {
+        return stats;
+    }
+    add_node_statistics(rootNode, 0, hashTable, stats);
+
+    vector<const Node*> subtrees;
+    for (const Node* childNode : rootNode->get_child_nodes()) {
+        if (childNode != nullptr) {
+            subtrees.push_back(childNode);
+        }
+    }
+    numberThreads = max(size_t(1), min(numberThreads, subtrees.size()));
+
+    // the subtrees differ a lot in size, so each thread fetches the next subtree as soon as it is done
+    vector<TreeStatistics> threadStats(numberThreads);
+    atomic<size_t> nextSubtree(0);
+    WorkerPool* pool = numberThreads > 1 ? new WorkerPool(numberThreads - 1) : nullptr;
+    parallel_for(pool, numberThreads, [&](size_t startIdx, size_t endIdx) {
+        for (size_t threadIdx = startIdx; threadIdx < endIdx; ++threadIdx) {
+            for (size_t idx = nextSubtree++; idx < subtrees.size(); idx = nextSubtree++) {
+                add_subtree_statistics(subtrees[idx], 1, hashTable, threadStats[threadIdx]);
+            }
+        }
+    });
+    delete pool;
+
+    for (const TreeStatistics& partialStats : threadStats) {
+        stats.merge(partialStats);
+    }
+    return stats;
+}
+
+string histogram_to_string(const vector<size_t>& histogram, bool powerOfTwoBins)
+{
+    stringstream ss;
+    for (size_t idx = 0; idx < histogram.size(); ++idx) {
+        if (powerOfTwoBins) {
+            ss << (size_t(1) << idx) << "+";
+        }
+        else {
+            ss << idx;
+        }
+        ss << ":" << histogram[idx] << " ";
+    }
+    return ss.str();
+}
+
+void print_tree_statistics(const TreeStatistics& stats)
+{
+    info_string("nodes", stats.numberNodes);
+    info_string("expanded nodes", stats.expandedNodes);
+    info_string("leaf nodes", stats.leafNodes);
+    info_string("terminal nodes", stats.terminalNodes);
+    info_string("transposition copies", stats.transpositionCopies);
+    info_string("depth histogram", histogram_to_string(stats.depthHistogram, false));
+    info_string("branching histogram", histogram_to_string(stats.branchingHistogram, true));
+
+    const size_t totalBytes = stats.total_bytes();
+    info_string("total bytes", totalBytes);
+    if (stats.numberNodes != 0) {
+        const float numberNodes = float(stats.numberNodes);
+        info_string("bytes per node", totalBytes / numberNodes);
+        info_string("  node object", stats.nodeBytes / numberNodes);
+        info_string("  board and state", stats.boardBytes / numberNodes);
+        info_string("  legal moves", stats.legalMoveBytes / numberNodes);
+        info_string("  child pointers", stats.childPointerBytes / numberNodes);
+        info_string("  statistic vectors", stats.statisticBytes / numberNodes);
+    }
+    info_string("hash table entries", stats.hashTableSize);
+    info_string("hash table buckets", stats.hashTableBuckets);
+    if (stats.hashTableBuckets != 0) {
+        info_string("hash table load factor", float(stats.hashTableSize) / stats.hashTableBuckets);
+    }
+}
@@ -0,0 +1,95 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: treestatistics.h
+ * Created on 19.10.2026
+ * @author: queensgambit
+ *
+ * Collects structural and memory statistics of a search tree, e.g. for the treestats command.
+ */
+
+#ifndef TREESTATISTICS_H
+#define TREESTATISTICS_H
+
+#include <vector>
+#include <unordered_map>
+#include "../node.h"
+
+using namespace std;
+
+struct TreeStatistics
+{
+    size_t numberNodes;
+    // nodes which have at least one child node in the tree
+    size_t expandedNodes;
+    // nodes without any child node in the tree
+    size_t leafNodes;
+    size_t terminalNodes;
+    // nodes which were created as a copy of a transposition (their hash entry points to another node)
+    size_t transpositionCopies;
+    // depthHistogram[d] is the number of nodes at depth d (the root has depth 0)
+    vector<size_t> depthHistogram;
+    // branchingHistogram[i] is the number of expanded nodes with [2^i, 2^(i+1)) child nodes in the tree
+    vector<size_t> branchingHistogram;
+
+    // memory footprint in bytes by component
+    size_t nodeBytes;
+    size_t boardBytes;
+    size_t legalMoveBytes;
+    size_t childPointerBytes;
+    size_t statisticBytes;
+
+    // transposition table occupancy
+    size_t hashTableSize;
+    size_t hashTableBuckets;
+
+    TreeStatistics();
+
+    /**
+     * @brief merge Adds the statistics of a different subtree to this one
+     * @param other Statistics of a disjoint subtree
+     */
+    void merge(const TreeStatistics& other);
+
+    /**
+     * @brief total_bytes Returns the summed memory footprint of all components
+     * @return size_t
+     */
+    size_t total_bytes() const;
+};
+
+/**
+ * @brief compute_tree_statistics Walks the whole tree below the root node and collects its statistics.
+ * The subtrees of the root's child nodes are distributed dynamically across the given number of threads.
+ * The tree must not be modified during the walk.
+ * @param rootNode Root node of the tree
+ * @param hashTable Transposition table of the search (can be a nullptr)
+ * @param numberThreads Number of threads used for the walk
+ * @return Statistics of the tree
+ */
+TreeStatistics compute_tree_statistics(const Node* rootNode, const unordered_map<Key, Node*>* hashTable, size_t numberThreads);
+
+/**
+ * @brief print_tree_statistics Prints the given statistics as info strings
+ * @param stats Statistics to print
+ */
+void print_tree_statistics(const TreeStatistics& stats);
+
+#endif // TREESTATISTICS_H
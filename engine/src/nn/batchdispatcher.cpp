@@ -0,0 +1,167 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: batchdispatcher.cpp
+ * Created on 19.10.2026
+ * @author: queensgambit
+ */
+
+#include "batchdispatcher.h"
+#include <cassert>
+#include "../domain/crazyhouse/constants.h"
+
+BatchDispatcher::BatchDispatcher(NeuralNetAPI* net, size_t batchSize, chrono::microseconds flushTimeout):
+    net(net),
+    batchSize(batchSize),
+    policyOutputSize(net->is_policy_map() ? NB_LABELS_POLICY_MAP : NB_LABELS),
+    numberPending(0),
+    activeRequesters(0),
+    flushTimeout(flushTimeout),
+    numberBatches(0),
+    numberPositions(0)
+{
+    inputPlanes = new float[batchSize * NB_VALUES_TOTAL];
+    fill(inputPlanes, inputPlanes + batchSize * NB_VALUES_TOTAL, 0.0f);
+    valueOutputs = new NDArray(Shape(batchSize, 1), Context::cpu());
+    probOutputs = new NDArray(Shape(batchSize, policyOutputSize), Context::cpu());
+}
+
+BatchDispatcher::~BatchDispatcher()
+{
+    delete [] inputPlanes;
+    delete valueOutputs;
+    delete probOutputs;
+}
+
+size_t BatchDispatcher::register_client(size_t clientBatchSize)
+{
+    lock_guard<mutex> lock(mtx);
+    DispatcherSlot slot;
+    slot.offset = slots.empty() ? 0 : slots.back().offset + slots.back().batchSize;
+    slot.batchSize = clientBatchSize;
+    slot.pending = false;
+    slot.valueOutput = nullptr;
+    slot.probOutputs = nullptr;
+    assert(slot.offset + slot.batchSize <= batchSize);
+    slots.push_back(slot);
+    return slots.size() - 1;
+}
+
+void BatchDispatcher::add_requesters(size_t number)
+{
+    lock_guard<mutex> lock(mtx);
+    activeRequesters += number;
+}
+
+void BatchDispatcher::remove_requesters(size_t number)
+{
+    lock_guard<mutex> lock(mtx);
+    activeRequesters -= number;
+    // the remaining requests mustn't wait for the flush timeout
+    if (numberPending != 0 && numberPending >= activeRequesters) {
+        run_batch();
+    }
+}
+
+void BatchDispatcher::predict(size_t slotIdx, const float* clientInputPlanes, NDArray& valueOutput, NDArray& probOutputs)
+{
+    unique_lock<mutex> lock(mtx);
+    DispatcherSlot& slot = slots[slotIdx];
+    copy(clientInputPlanes, clientInputPlanes + slot.batchSize * NB_VALUES_TOTAL, inputPlanes + slot.offset * NB_VALUES_TOTAL);
+    slot.pending = true;
+    slot.valueOutput = &valueOutput;
+    slot.probOutputs = &probOutputs;
+    ++numberPending;
+
+    if (numberPending >= activeRequesters) {
+        run_batch();
+        return;
+    }
+    if (!resultsReady.wait_for(lock, flushTimeout, [&slot]{ return !slot.pending; })) {
+        // some clients are busy with other work, so the batch is run without their requests
+        run_batch();
+    }
+}
+
+void BatchDispatcher::run_batch()
+{
+    net->predict(inputPlanes, *valueOutputs, *probOutputs);
+    const float* valueData = valueOutputs->GetData();
+    const float* policyData = probOutputs->GetData();
+
+    for (DispatcherSlot& slot : slots) {
+        if (!slot.pending) {
+            continue;
+        }
+        slot.valueOutput->SyncCopyFromCPU(valueData + slot.offset, slot.batchSize);
+        slot.probOutputs->SyncCopyFromCPU(policyData + slot.offset * policyOutputSize, slot.batchSize * policyOutputSize);
+        slot.pending = false;
+        numberPositions += slot.batchSize;
+    }
+    numberPending = 0;
+    ++numberBatches;
+    resultsReady.notify_all();
+}
+
+size_t BatchDispatcher::get_policy_output_size() const
+{
+    return policyOutputSize;
+}
+
+size_t BatchDispatcher::get_number_batches() const
+{
+    return numberBatches;
+}
+
+size_t BatchDispatcher::get_number_positions() const
+{
+    return numberPositions;
+}
+
+size_t BatchDispatcher::get_total_batch_size() const
+{
+    return batchSize;
+}
+
+const NeuralNetAPI* BatchDispatcher::get_net() const
+{
+    return net;
+}
+
+DispatchedNeuralNetAPI::DispatchedNeuralNetAPI(BatchDispatcher* dispatcher, unsigned int batchSize, const string& deviceName):
+    NeuralNetAPI(batchSize, dispatcher->get_net()->is_policy_map(), dispatcher->get_net()->get_model_name(), deviceName),
+    dispatcher(dispatcher),
+    slotIdx(dispatcher->register_client(batchSize))
+{
+}
+
+NDArray DispatchedNeuralNetAPI::predict(float *inputPlanes, float &value)
+{
+    NDArray valueOutput(Shape(batchSize, 1), Context::cpu());
+    NDArray probOutputs(Shape(batchSize, dispatcher->get_policy_output_size()), Context::cpu());
+    dispatcher->predict(slotIdx, inputPlanes, valueOutput, probOutputs);
+    value = valueOutput.GetData()[0];
+    return probOutputs;
+}
+
+void DispatchedNeuralNetAPI::predict(float *inputPlanes, NDArray &valueOutput, NDArray &probOutputs)
+{
+    dispatcher->predict(slotIdx, inputPlanes, valueOutput, probOutputs);
+}
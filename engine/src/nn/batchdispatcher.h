@@ -0,0 +1,141 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: batchdispatcher.h
+ * Created on 19.10.2026
+ * @author: queensgambit
+ *
+ * Pools the inference requests of several independent searches (e.g. concurrent self-play games) into one large batch
+ * for a single network instance. Every search uses a DispatchedNeuralNetAPI which owns a fixed slot in the shared batch.
+ */
+
+#ifndef BATCHDISPATCHER_H
+#define BATCHDISPATCHER_H
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "neuralnetapi.h"
+
+using namespace std;
+
+// region of a single client in the shared batch
+struct DispatcherSlot
+{
+    size_t offset;
+    size_t batchSize;
+    bool pending;
+    NDArray* valueOutput;
+    NDArray* probOutputs;
+};
+
+class BatchDispatcher
+{
+private:
+    NeuralNetAPI* net;
+    mutex mtx;
+    // signals the waiting clients that their results are available
+    condition_variable resultsReady;
+    vector<DispatcherSlot> slots;
+    float* inputPlanes;
+    NDArray* valueOutputs;
+    NDArray* probOutputs;
+    size_t batchSize;
+    size_t policyOutputSize;
+    size_t numberPending;
+    // number of clients which are currently expected to send requests
+    size_t activeRequesters;
+    // pending requests are processed after this time even if not all active requesters have sent their request
+    chrono::microseconds flushTimeout;
+
+    // statistics
+    size_t numberBatches;
+    size_t numberPositions;
+
+    /**
+     * @brief run_batch Runs the network on the shared batch and copies the results of all pending requests to their clients.
+     * The mutex must be locked by the caller.
+     */
+    void run_batch();
+
+public:
+    /**
+     * @brief BatchDispatcher
+     * @param net Network which is used for all requests
+     * @param batchSize Batch size of the network, which limits the sum of the batch sizes of all registered clients
+     * @param flushTimeout Maximum waiting time of a request for requests of other clients
+     */
+    BatchDispatcher(NeuralNetAPI* net, size_t batchSize, chrono::microseconds flushTimeout);
+    ~BatchDispatcher();
+
+    /**
+     * @brief register_client Reserves a slot of the given batch size in the shared batch. All clients must be registered before the first request.
+     * @return Slot index of the client
+     */
+    size_t register_client(size_t batchSize);
+
+    /**
+     * @brief add_requesters Announces that the given number of clients will send requests from now on
+     */
+    void add_requesters(size_t number);
+
+    /**
+     * @brief remove_requesters Announces that the given number of clients won't send requests anymore
+     */
+    void remove_requesters(size_t number);
+
+    /**
+     * @brief predict Adds the request of a client to the shared batch and blocks until its results are available.
+     * The batch is run as soon as all active requesters have sent a request or the flush timeout has expired.
+     * @param slotIdx Slot of the client
+     * @param inputPlanes Input planes of the client's batch
+     * @param valueOutput Output for the values, it must have the shape (batchSize, 1) of the client
+     * @param probOutputs Output for the policies, it must have the shape (batchSize, policyOutputSize) of the client
+     */
+    void predict(size_t slotIdx, const float* inputPlanes, NDArray& valueOutput, NDArray& probOutputs);
+
+    size_t get_policy_output_size() const;
+    size_t get_number_batches() const;
+    size_t get_number_positions() const;
+    size_t get_total_batch_size() const;
+    const NeuralNetAPI* get_net() const;
+};
+
+class DispatchedNeuralNetAPI : public NeuralNetAPI
+{
+private:
+    BatchDispatcher* dispatcher;
+    size_t slotIdx;
+
+public:
+    /**
+     * @brief DispatchedNeuralNetAPI Registers a new client of the given batch size at the dispatcher
+     * @param dispatcher Dispatcher which runs the network
+     * @param batchSize Constant batch size which is used for inference
+     * @param deviceName Name which is reported for the device (e.g. to distinguish the output files of concurrent games)
+     */
+    DispatchedNeuralNetAPI(BatchDispatcher* dispatcher, unsigned int batchSize, const string& deviceName);
+
+    NDArray predict(float *inputPlanes, float &value) override;
+    void predict(float *inputPlanes, NDArray &valueOutput, NDArray &probOutputs) override;
+};
+
+#endif // BATCHDISPATCHER_H
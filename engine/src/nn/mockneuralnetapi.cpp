@@ -0,0 +1,112 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: mockneuralnetapi.cpp
+ * Created on 19.10.2026
+ * @author: queensgambit
+ */
+
+#include "mockneuralnetapi.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include "../domain/crazyhouse/constants.h"
+
+MockNeuralNetAPI::MockNeuralNetAPI(unsigned int batchSize, bool isPolicyMap, MockPolicyType policyType, size_t latencyMicros):
+    NeuralNetAPI(batchSize, isPolicyMap, policyType == MOCK_UNIFORM ? "mock-uniform" : "mock-hash", "cpu_mock"),
+    policyType(policyType),
+    latencyMicros(latencyMicros),
+    policyOutputSize(isPolicyMap ? NB_LABELS_POLICY_MAP : NB_LABELS),
+    valueBuffer(batchSize),
+    policyBuffer(batchSize * policyOutputSize),
+    numberPredictions(0),
+    inferenceMicros(0)
+{
+}
+
+void MockNeuralNetAPI::fill_outputs(const float* inputPlanes, size_t numberPositions)
+{
+    const auto startTime = chrono::steady_clock::now();
+
+    for (size_t batchIdx = 0; batchIdx < numberPositions; ++batchIdx) {
+        float* policy = policyBuffer.data() + batchIdx * policyOutputSize;
+        if (policyType == MOCK_UNIFORM) {
+            // a policy map output is expected to be a probability distribution, otherwise logits are returned
+            fill(policy, policy + policyOutputSize, isPolicyMap ? 1.0f : 0.0f);
+            valueBuffer[batchIdx] = 0.0f;
+            continue;
+        }
+        uint64_t state = hash_input_planes(inputPlanes + batchIdx * NB_VALUES_TOTAL) | 1;
+        for (size_t idx = 0; idx < policyOutputSize; ++idx) {
+            // xorshift64 random number generator, mapped to a logit in [-2, 2]
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            const float logit = float(state >> 40) / float(1 << 24) * 4.0f - 2.0f;
+            policy[idx] = isPolicyMap ? exp(logit) : logit;
+        }
+        valueBuffer[batchIdx] = float(state >> 40) / float(1 << 24) - 0.5f;
+    }
+
+    // busy waiting is used because sleeping isn't precise enough for latencies in the microsecond range
+    const chrono::microseconds latency(latencyMicros);
+    while (chrono::steady_clock::now() - startTime < latency) {
+    }
+    ++numberPredictions;
+    inferenceMicros += size_t(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - startTime).count());
+}
+
+NDArray MockNeuralNetAPI::predict(float *inputPlanes, float &value)
+{
+    fill_outputs(inputPlanes, batchSize);
+    value = valueBuffer[0];
+    NDArray probOutputs(Shape(batchSize, policyOutputSize), Context::cpu());
+    probOutputs.SyncCopyFromCPU(policyBuffer.data(), batchSize * policyOutputSize);
+    return probOutputs;
+}
+
+void MockNeuralNetAPI::predict(float *inputPlanes, NDArray &valueOutput, NDArray &probOutputs)
+{
+    fill_outputs(inputPlanes, batchSize);
+    valueOutput.SyncCopyFromCPU(valueBuffer.data(), batchSize);
+    probOutputs.SyncCopyFromCPU(policyBuffer.data(), batchSize * policyOutputSize);
+}
+
+size_t MockNeuralNetAPI::get_number_predictions() const
+{
+    return numberPredictions;
+}
+
+size_t MockNeuralNetAPI::get_inference_micros() const
+{
+    return inferenceMicros;
+}
+
+uint64_t hash_input_planes(const float* inputPlanes)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t idx = 0; idx < NB_VALUES_TOTAL; ++idx) {
+        uint32_t bits;
+        memcpy(&bits, &inputPlanes[idx], sizeof(bits));
+        hash ^= bits;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,87 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: mockneuralnetapi.h
+ * Created on 19.10.2026
+ * @author: queensgambit
+ *
+ * Fake neural network which returns synthetic predictions with a constant latency.
+ * It allows reproducible measurements of the search itself without loading any model files.
+ */
+
+#ifndef MOCKNEURALNETAPI_H
+#define MOCKNEURALNETAPI_H
+
+#include <vector>
+#include "neuralnetapi.h"
+
+enum MockPolicyType {
+    // all moves get the same prior and every position is evaluated as a draw
+    MOCK_UNIFORM,
+    // the priors and the value are derived from a hash of the input planes, so equal positions always get the same prediction
+    MOCK_HASH_SEEDED
+};
+
+class MockNeuralNetAPI : public NeuralNetAPI
+{
+private:
+    MockPolicyType policyType;
+    // synthetic latency of a single prediction call in microseconds (busy waiting)
+    size_t latencyMicros;
+    size_t policyOutputSize;
+    vector<float> valueBuffer;
+    vector<float> policyBuffer;
+
+    // accumulated statistics of all prediction calls
+    size_t numberPredictions;
+    size_t inferenceMicros;
+
+    /**
+     * @brief fill_outputs Fills the value and policy buffers for the given number of input positions
+     * @param inputPlanes Input planes of the batch
+     * @param numberPositions Number of positions to fill
+     */
+    void fill_outputs(const float* inputPlanes, size_t numberPositions);
+
+public:
+    /**
+     * @brief MockNeuralNetAPI
+     * @param batchSize Constant batch size which is used for inference
+     * @param isPolicyMap Sets if the policy is encoded in policy map representation (must match the initialized move look-up tables)
+     * @param policyType Defines how the synthetic predictions are generated
+     * @param latencyMicros Synthetic latency of a single prediction call in microseconds
+     */
+    MockNeuralNetAPI(unsigned int batchSize, bool isPolicyMap, MockPolicyType policyType, size_t latencyMicros);
+
+    NDArray predict(float *inputPlanes, float &value) override;
+    void predict(float *inputPlanes, NDArray &valueOutput, NDArray &probOutputs) override;
+
+    size_t get_number_predictions() const;
+    size_t get_inference_micros() const;
+};
+
+/**
+ * @brief hash_input_planes Returns a FNV-1a hash of the input planes of a single position
+ * @param inputPlanes Input planes of the position
+ * @return Hash value
+ */
+uint64_t hash_input_planes(const float* inputPlanes);
+
+#endif // MOCKNEURALNETAPI_H
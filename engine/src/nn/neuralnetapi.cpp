@@ -50,8 +50,8 @@ vector<string> get_directory_files(const string& dir) {
 }  // namespace
 
 NeuralNetAPI::NeuralNetAPI(const string& ctx, int deviceID, unsigned int batchSize, const string& modelDirectory, bool enableTensorrt):
-    batchSize(batchSize),
-    enableTensorrt(enableTensorrt)
+    enableTensorrt(enableTensorrt),
+    batchSize(batchSize)
 {
     if (ctx == "cpu" || ctx == "CPU") {
         globalCtx = Context::cpu();
@@ -90,6 +90,16 @@ NeuralNetAPI::NeuralNetAPI(const string& ctx, int deviceID, unsigned int batchSi
     check_if_policy_map();
 }
 
+NeuralNetAPI::NeuralNetAPI(unsigned int batchSize, bool isPolicyMap, const string& modelName, const string& deviceName):
+    executor(nullptr),
+    enableTensorrt(false),
+    batchSize(batchSize),
+    isPolicyMap(isPolicyMap),
+    modelName(modelName),
+    deviceName(deviceName)
+{
+}
+
 NeuralNetAPI::~NeuralNetAPI()
 {
     delete executor;
@@ -49,12 +49,7 @@ private:
     Executor *executor;
     Shape inputShape;
     Context globalCtx = Context::cpu();
-    unsigned int batchSize;
-    bool isPolicyMap;
     bool enableTensorrt;
-    // defines the name for the model based on the loaded .params file
-    string modelName;
-    string deviceName;
 
     /**
      * @brief FileExists Function to check if a file exists in a given path
@@ -108,6 +103,22 @@ private:
         std::map<std::string, NDArray> *paramMapInTargetContext,
         Context targetContext);
 
+protected:
+    unsigned int batchSize;
+    bool isPolicyMap;
+    // defines the name for the model based on the loaded .params file
+    string modelName;
+    string deviceName;
+
+    /**
+     * @brief NeuralNetAPI Constructor for derived classes which provide their own predictions and don't load a model
+     * @param batchSize Constant batch size which is used for inference
+     * @param isPolicyMap Sets if the policy is encoded in policy map representation
+     * @param modelName Name which is reported for the model
+     * @param deviceName Name which is reported for the device
+     */
+    NeuralNetAPI(unsigned int batchSize, bool isPolicyMap, const string& modelName, const string& deviceName);
+
 public:
     /**
      * @brief NeuralNetAPI
@@ -119,7 +130,7 @@ public:
      */
     NeuralNetAPI(const string& ctx, int deviceID, unsigned int batchSize, const string& modelDirectory, bool enableTensorrt);
 
-    ~NeuralNetAPI();
+    virtual ~NeuralNetAPI();
 
     /**
      * @brief predict Runs a prediction on the given inputPlanes and returns the policy vector in form of a NDArray and the value as a float number
@@ -127,7 +138,7 @@ public:
      * @param value Value prediction for the board by the neural network
      * @return Policy NDArray
      */
-    NDArray predict(float *inputPlanes, float &value);
+    virtual NDArray predict(float *inputPlanes, float &value);
 
     /**
      * @brief predict Runs a prediction on the given inputPlanes and returns the policy vector in form of a NDArray and the value as a float number
@@ -135,7 +146,7 @@ public:
      * @param value Value prediction for the board by the neural network
      * @param probOutputs Policy NDArray of the raw network output (including illegal moves). It's assumend that the memory has already been allocated.
      */
-    void predict(float *inputPlanes, NDArray &valueOutput, NDArray &probOutputs);
+    virtual void predict(float *inputPlanes, NDArray &valueOutput, NDArray &probOutputs);
 
     bool is_policy_map() const;
     string get_model_name() const;
@@ -26,6 +26,7 @@
 #include "node.h"
 #include "util/blazeutil.h" // get_dirichlet_noise()
 #include "constants.h"
+#include "outputrepresentation.h"
 #include "../util/sfutil.h"
 #include "../util/communication.h"
 
@@ -33,6 +34,10 @@
 Node::Node(Board *pos, Node *parentNode, size_t childIdxForParent, SearchSettings* searchSettings):
     pos(pos),
     parentNode(parentNode),
+    key(pos->hash_key()),
+    sideToMove(pos->side_to_move()),
+    pliesFromNull(pos->get_state_info()->pliesFromNull),
+    rule50(pos->get_state_info()->rule50),
     visits(1),
     noVisitIdx(1),
     isTerminal(false),
@@ -42,11 +47,9 @@ Node::Node(Board *pos, Node *parentNode, size_t childIdxForParent, SearchSetting
     checkmateIdx(-1),
     searchSettings(searchSettings)
 {
+    // specifies the number of direct child nodes from this node
     fill_child_node_moves();
 
-    // specify thisTerminale number of direct child nodes from this node
-    numberChildNodes = legalMoves.size();
-
     check_for_terminal();
 
     // # visit count of all its child nodes
@@ -63,15 +66,24 @@ Node::Node(Board *pos, Node *parentNode, size_t childIdxForParent, SearchSetting
     qValues = DynamicVector<float>(numberChildNodes);
     qValues = -1;
 
-    childNodes.resize(numberChildNodes, nullptr);
     policyProbSmall.resize(numberChildNodes);
+    if (numberChildNodes != 0) {
+        // the four statistic vectors
+        count_allocations(4);
+    }
 }
 
 Node::Node(const Node &b)
 {
     value = b.value;
     //    pos = b.pos;
-    numberChildNodes = b.numberChildNodes;
+    pos = nullptr;
+    key = b.key;
+    sideToMove = b.sideToMove;
+    pliesFromNull = b.pliesFromNull;
+    rule50 = b.rule50;
+    allocate_child_block(b.numberChildNodes);
+    copy(b.legalMoves, b.legalMoves + numberChildNodes, legalMoves);
     policyProbSmall.resize(numberChildNodes);
     policyProbSmall = b.policyProbSmall;
     childNumberVisits.resize(numberChildNodes);
@@ -80,11 +92,12 @@ Node::Node(const Node &b)
     actionValues = 0;
     qValues.resize(numberChildNodes);
     qValues = -1;
-    legalMoves = b.legalMoves;
+    if (numberChildNodes != 0) {
+        count_allocations(4);
+    }
     isTerminal = b.isTerminal;
     //    initialValue = b.initialValue;
     visits = 1;
-    childNodes.resize(numberChildNodes);
     //    parentNode = // is not copied
     //    childIdxForParent = // is not copied
     noVisitIdx = 1; // reset counter
@@ -95,11 +108,30 @@ Node::Node(const Node &b)
     isFullyExpanded = false;
 }
 
+void Node::allocate_child_block(size_t numberChildNodes)
+{
+    this->numberChildNodes = numberChildNodes;
+    if (numberChildNodes == 0) {
+        childNodes = nullptr;
+        legalMoves = nullptr;
+        return;
+    }
+    // the moves are stored behind the pointers, so the block is rounded up to full pointer slots
+    const size_t moveSlots = (numberChildNodes * sizeof(Move) + sizeof(Node*) - 1) / sizeof(Node*);
+    childNodes = new Node*[numberChildNodes + moveSlots];
+    fill_n(childNodes, numberChildNodes, nullptr);
+    legalMoves = reinterpret_cast<Move*>(childNodes + numberChildNodes);
+    count_allocations(1);
+}
+
 void Node::fill_child_node_moves()
 {
-    // generate the legal moves and save them in the list
-    for (const ExtMove& move : MoveList<LEGAL>(*pos)) {
-        legalMoves.push_back(move);
+    // the number of legal moves is known before the block is allocated, so it is exactly sized
+    const MoveList<LEGAL> moveList(*pos);
+    allocate_child_block(moveList.size());
+    size_t moveIdx = 0;
+    for (const ExtMove& move : moveList) {
+        legalMoves[moveIdx++] = move;
     }
 }
 
@@ -112,6 +144,7 @@ void Node::mark_nodes_as_fully_expanded()
 Node::~Node()
 {
     delete pos;
+    delete [] childNodes;
 }
 
 void Node::sort_moves_by_probabilities()
@@ -119,7 +152,7 @@ void Node::sort_moves_by_probabilities()
     auto p = sort_permutation(policyProbSmall, std::greater<float>());
 
     apply_permutation_in_place(policyProbSmall, p);
-    apply_permutation_in_place(legalMoves, p);
+    apply_permutation_in_place(legalMoves, numberChildNodes, p);
 }
 
 Move Node::get_move(size_t childIdx) const
@@ -127,9 +160,9 @@ Move Node::get_move(size_t childIdx) const
     return legalMoves[childIdx];
 }
 
-vector<Node*> Node::get_child_nodes() const
+Span<Node* const> Node::get_child_nodes() const
 {
-    return childNodes;
+    return Span<Node* const>(childNodes, numberChildNodes);
 }
 
 bool Node::is_terminal() const
@@ -144,7 +177,7 @@ bool Node::has_nn_results() const
 
 Color Node::side_to_move() const
 {
-    return pos->side_to_move();
+    return sideToMove;
 }
 
 Board* Node::get_pos() const
@@ -152,16 +185,31 @@ Board* Node::get_pos() const
     return pos;
 }
 
-void Node::apply_virtual_loss_to_child(size_t childIdx)
+void Node::set_pos(Board* value)
+{
+    pos = value;
+}
+
+int Node::get_plies_from_null() const
+{
+    return pliesFromNull;
+}
+
+int Node::get_rule50() const
+{
+    return rule50;
+}
+
+void Node::apply_virtual_loss_to_child(size_t childIdx, float virtualLoss)
 {
     // update the stats of the parent node
     // temporarily reduce the attraction of this node by applying a virtual loss /
     // the effect of virtual loss will be undone if the playout is over
     // virtual increase the number of visits
-    visits += searchSettings->virtualLoss;
-    childNumberVisits[childIdx] +=  searchSettings->virtualLoss;
+    visits += virtualLoss;
+    childNumberVisits[childIdx] +=  virtualLoss;
     // make it look like if one has lost X games from this node forward where X is the virtual loss value
-    actionValues[childIdx] -=  searchSettings->virtualLoss;
+    actionValues[childIdx] -=  virtualLoss;
     qValues[childIdx] = actionValues[childIdx] / childNumberVisits[childIdx];
 }
 
@@ -201,7 +249,7 @@ float Node::get_value() const
 
 Key Node::hash_key() const
 {
-    return pos->hash_key();
+    return key;
 }
 
 size_t Node::get_number_child_nodes() const
@@ -214,43 +262,64 @@ float Node::get_visits() const
     return visits;
 }
 
-void Node::backup_value(size_t childIdx, float value)
+void Node::backup_value(size_t childIdx, float value, float virtualLoss)
 {
     Node* currentNode = this;
     do {
-        currentNode->revert_virtual_loss_and_update(childIdx, value);
+        currentNode->revert_virtual_loss_and_update(childIdx, value, virtualLoss);
         childIdx = currentNode->childIdxForParent;
         value = -value;
         currentNode = currentNode->parentNode;
     } while(currentNode != nullptr);
 }
 
-void Node::revert_virtual_loss_and_update(size_t childIdx, float value)
+void Node::revert_virtual_loss_and_update(size_t childIdx, float value, float virtualLoss)
 {
     mtx.lock();
-    visits -= searchSettings->virtualLoss - 1;
-    childNumberVisits[childIdx] -= searchSettings->virtualLoss - 1;
-    actionValues[childIdx] += searchSettings->virtualLoss + value;
+    visits -= virtualLoss - 1;
+    childNumberVisits[childIdx] -= virtualLoss - 1;
+    actionValues[childIdx] += virtualLoss + value;
     qValues[childIdx] = actionValues[childIdx] / childNumberVisits[childIdx];
     mtx.unlock();
 }
 
-void Node::backup_collision(size_t childIdx)
+void Node::backup_multi_visit_value(size_t childIdx, float value, float virtualLoss, float multiplicity)
 {
     Node* currentNode = this;
     do {
-        currentNode->revert_virtual_loss(childIdx);
+        currentNode->revert_virtual_loss_and_update_multi_visit(childIdx, value, virtualLoss, multiplicity);
+        childIdx = currentNode->childIdxForParent;
+        value = -value;
+        currentNode = currentNode->parentNode;
+    } while(currentNode != nullptr);
+}
+
+void Node::revert_virtual_loss_and_update_multi_visit(size_t childIdx, float value, float virtualLoss, float multiplicity)
+{
+    mtx.lock();
+    visits -= multiplicity * (virtualLoss - 1);
+    childNumberVisits[childIdx] -= multiplicity * (virtualLoss - 1);
+    actionValues[childIdx] += multiplicity * (virtualLoss + value);
+    qValues[childIdx] = actionValues[childIdx] / childNumberVisits[childIdx];
+    mtx.unlock();
+}
+
+void Node::backup_collision(size_t childIdx, float virtualLoss)
+{
+    Node* currentNode = this;
+    do {
+        currentNode->revert_virtual_loss(childIdx, virtualLoss);
         childIdx = currentNode->childIdxForParent;
         currentNode = currentNode->parentNode;
     } while (currentNode != nullptr);
 }
 
-void Node::revert_virtual_loss(size_t childIdx)
+void Node::revert_virtual_loss(size_t childIdx, float virtualLoss)
 {
     mtx.lock();
-    visits -= searchSettings->virtualLoss;
-    childNumberVisits[childIdx] -= searchSettings->virtualLoss;
-    actionValues[childIdx] += searchSettings->virtualLoss;
+    visits -= virtualLoss;
+    childNumberVisits[childIdx] -= virtualLoss;
+    actionValues[childIdx] += virtualLoss;
     qValues[childIdx] = actionValues[childIdx] / childNumberVisits[childIdx];
     mtx.unlock();
 }
@@ -319,9 +388,9 @@ float Node::updated_value_eval()
     return qValues[argmax(childNumberVisits)];
 }
 
-std::vector<Move> Node::get_legal_moves() const
+Span<const Move> Node::get_legal_moves() const
 {
-    return legalMoves;
+    return Span<const Move>(legalMoves, numberChildNodes);
 }
 
 int Node::get_checkmate_idx() const
@@ -339,6 +408,11 @@ void Node::enable_has_nn_results()
     hasNNResults = true;
 }
 
+size_t Node::get_statistic_bytes() const
+{
+    return (policyProbSmall.capacity() + childNumberVisits.capacity() + actionValues.capacity() + qValues.capacity()) * sizeof(float);
+}
+
 void Node::check_for_terminal()
 {
     if (numberChildNodes == 0) {
@@ -351,10 +425,13 @@ void Node::check_for_terminal()
         }
 #endif
         // test if we have a check-mate
-        if (parentNode->pos->gives_check(parentNode->legalMoves[childIdxForParent])) {
+        // (the own position is used because the parent node might not store its board position)
+        if (pos->checkers()) {
             value = LOSS;
             isTerminal = true;
-            parentNode->checkmateIdx = int(childIdxForParent);
+            if (parentNode != nullptr) {
+                parentNode->checkmateIdx = int(childIdxForParent);
+            }
             return;
         }
         // we reached a stalmate
@@ -371,7 +448,9 @@ void Node::check_for_terminal()
         if (pos->is_anti_loss()) {
             isTerminal = true;
             value = LOSS;
-            parentNode->checkmateIdx = int(childIdxForParent);
+            if (parentNode != nullptr) {
+                parentNode->checkmateIdx = int(childIdxForParent);
+            }
             return;
         }
     }
@@ -412,25 +491,12 @@ void Node::apply_temperature_to_prior_policy(float temperature)
     apply_temperature(policyProbSmall, temperature);
 }
 
-void Node::set_probabilities_for_moves(const float *data, unordered_map<Move, size_t>& moveLookup)
+void Node::set_probabilities_for_moves(const float *data, const unordered_map<Move, size_t>& moveLookup, bool isPolicyMap, float temperature)
 {
-    //    // allocate sufficient memory -> is assumed that it has already been done
-    assert(legalMoves.size() == policyProbSmall.size());
-    for (size_t mvIdx = 0; mvIdx < legalMoves.size(); ++mvIdx) {
-        // retrieve vector index from look-up table
-        // set the right prob value
-        // accessing the data on the raw floating point vector is faster
-        // than calling policyProb.At(batchIdx, vectorIdx)
-        policyProbSmall[mvIdx] = data[moveLookup[legalMoves[mvIdx]]];
-    }
+    get_probs_of_moves_with_temperature(data, get_legal_moves(), moveLookup, isPolicyMap, temperature, policyProbSmall);
 }
 
-void Node::apply_softmax_to_policy()
-{
-    policyProbSmall = softmax(policyProbSmall);
-}
-
-void Node::enhance_moves()
+void Node::enhance_moves(const Board* nodePos)
 {
     if (!searchSettings->enhanceChecks && !searchSettings->enhanceCaptures) {
         return;
@@ -441,11 +507,11 @@ void Node::enhance_moves()
 
     if (searchSettings->enhanceChecks) {
         checkUpdate = enhance_move_type(min(searchSettings->threshCheck, policyProbSmall[0]*searchSettings->checkFactor),
-                searchSettings->threshCheck, pos, legalMoves, isCheck, policyProbSmall);
+                searchSettings->threshCheck, nodePos, get_legal_moves(), isCheck, policyProbSmall);
     }
     if (searchSettings->enhanceCaptures) {
         captureUpdate = enhance_move_type(min(searchSettings->threshCapture, policyProbSmall[0]*searchSettings->captureFactor),
-                searchSettings->threshCheck, pos, legalMoves, isCapture, policyProbSmall);
+                searchSettings->threshCheck, nodePos, get_legal_moves(), isCapture, policyProbSmall);
     }
 
     if (checkUpdate || captureUpdate) {
@@ -453,7 +519,7 @@ void Node::enhance_moves()
     }
 }
 
-bool enhance_move_type(float increment, float thresh, const Board* pos, const vector<Move>& legalMoves, vFunctionMoveType func, DynamicVector<float>& policyProbSmall)
+bool enhance_move_type(float increment, float thresh, const Board* pos, Span<const Move> legalMoves, vFunctionMoveType func, DynamicVector<float>& policyProbSmall)
 {
     bool update = false;
     for (size_t i = 0; i < legalMoves.size(); ++i) {
@@ -519,6 +585,46 @@ void Node::get_principal_variation(vector<Move>& pv) const
     } while (curNode != nullptr && !curNode->is_terminal());
 }
 
+void Node::get_principal_variation(size_t childIdx, vector<Move>& pv) const
+{
+    pv.clear();
+    pv.push_back(get_move(childIdx));
+    const Node* childNode = childNodes[childIdx];
+    if (childNode != nullptr && !childNode->is_terminal() && childNode->get_number_child_nodes() != 0) {
+        vector<Move> childPv;
+        childNode->get_principal_variation(childPv);
+        pv.insert(pv.end(), childPv.begin(), childPv.end());
+    }
+}
+
+void Node::get_best_child_indices(size_t k, vector<size_t>& indices) const
+{
+    indices.clear();
+    if (numberChildNodes == 0) {
+        return;
+    }
+    DynamicVector<float> mctsPolicy(numberChildNodes);
+    get_mcts_policy(mctsPolicy);
+    for (size_t childIdx = 0; childIdx < numberChildNodes; ++childIdx) {
+        if (childNumberVisits[childIdx] > 0) {
+            indices.push_back(childIdx);
+        }
+    }
+    if (indices.empty()) {
+        indices.push_back(argmax(mctsPolicy));
+        return;
+    }
+    const size_t numberIndices = min(k, indices.size());
+    partial_sort(indices.begin(), indices.begin() + numberIndices, indices.end(),
+                 [&mctsPolicy](size_t idxA, size_t idxB) { return mctsPolicy[idxA] > mctsPolicy[idxB]; });
+    indices.resize(numberIndices);
+}
+
+float Node::get_q_value(size_t childIdx) const
+{
+    return qValues[childIdx];
+}
+
 size_t Node::select_child_node()
 {
     if (checkmateIdx != -1) {
@@ -537,7 +643,7 @@ size_t Node::select_child_node()
 ostream& operator<<(ostream &os, const Node *node)
 {
     for (size_t childIdx = 0; childIdx < node->get_number_child_nodes(); ++childIdx) {
-        os << childIdx << ".move " << UCI::move(node->get_legal_moves()[childIdx], false)
+        os << childIdx << ".move " << UCI::move(node->legalMoves[childIdx], false)
            << "\tn " << node->childNumberVisits[childIdx]
               << "\tp " << node->policyProbSmall[childIdx]
                  << "\tQ " << node->qValues[childIdx]
@@ -577,6 +683,19 @@ void delete_subtree_and_hash_entries(Node* node, unordered_map<Key, Node*>* hash
     delete node;
 }
 
+// heap allocations of the tree structures which have been done by the current thread
+thread_local size_t threadAllocations = 0;
+
+void count_allocations(size_t number)
+{
+    threadAllocations += number;
+}
+
+size_t get_thread_allocations()
+{
+    return threadAllocations;
+}
+
 float get_visits(Node* node)
 {
     return node->get_visits();
@@ -30,6 +30,7 @@
 
 #include <iostream>
 #include <mutex>
+#include <algorithm>
 #include <unordered_map>
 
 #include <blaze/Math.h>
@@ -40,6 +41,7 @@
 
 #include "agents/config/searchsettings.h"
 #include "constants.h"
+#include "util/span.h"
 
 using blaze::HybridVector;
 using blaze::DynamicVector;
@@ -49,9 +51,16 @@ class Node
 {
 private:
     mutex mtx;
+    // can be a nullptr if the position is reconstructed during search (see SearchSettings::reconstructPositions)
     Board* pos;
     Node* parentNode;
 
+    // position information which is cached on construction and remains available without a board position
+    Key key;
+    Color sideToMove;
+    int pliesFromNull;
+    int rule50;
+
     // singular values
     float value;
     float visits;
@@ -64,8 +73,9 @@ private:
     size_t numberChildNodes;
     size_t noVisitIdx;
 
-    vector<Node*> childNodes;
-    std::vector<Move> legalMoves;
+    // the child node pointers and the legal moves share a single exactly sized block which starts at childNodes
+    Node** childNodes;
+    Move* legalMoves;
     bool isTerminal;
     size_t childIdxForParent;
     bool hasNNResults;
@@ -81,7 +91,13 @@ private:
     inline void check_for_terminal();
 
     /**
-     * @brief fill_child_node_moves Generates the legal moves and save them in the list
+     * @brief allocate_child_block Allocates the block for the child node pointers (initialized with nullptr) and the legal moves
+     * @param numberChildNodes Number of legal moves
+     */
+    void allocate_child_block(size_t numberChildNodes);
+
+    /**
+     * @brief fill_child_node_moves Generates the legal moves and saves them in the child block
      */
     void fill_child_node_moves();
 
@@ -103,6 +119,7 @@ public:
      * @param b Node from which the stats will be copied
      */
     Node(const Node& b);
+    Node& operator=(const Node&) = delete;
 
     /**
      * @brief ~Node Destructor which frees memory and the board position
@@ -129,37 +146,74 @@ public:
      * @brief backup_value Iteratively backpropagates a value prediction across all of the parents for this node.
      * The value is flipped at every ply.
      * @param value Value evaluation to backup, this is the NN eval in the general case or can be from a terminal node
+     * @param virtualLoss Virtual loss which was applied on the way down and is reverted now
      */
-    void backup_value(size_t childIdx, float value);
+    void backup_value(size_t childIdx, float value, float virtualLoss);
 
     /**
      * @brief revert_virtual_loss_and_update Revert the virtual loss effect and apply the backpropagated value of its child node
      * @param childIdx Index to the child node to update
      * @param value Specifies the value evaluation to backpropagate
+     * @param virtualLoss Virtual loss which was applied on the way down
      */
-    void revert_virtual_loss_and_update(size_t childIdx, float value);
+    void revert_virtual_loss_and_update(size_t childIdx, float value, float virtualLoss);
+
+    /**
+     * @brief backup_multi_visit_value Iteratively backpropagates a value for several rollouts which all selected the same path.
+     * All rollouts are handled within a single traversal.
+     * @param childIdx Index to the child node to update
+     * @param value Value evaluation to backup
+     * @param virtualLoss Virtual loss which was applied on the way down by each rollout
+     * @param multiplicity Number of rollouts
+     */
+    void backup_multi_visit_value(size_t childIdx, float value, float virtualLoss, float multiplicity);
+
+    /**
+     * @brief revert_virtual_loss_and_update_multi_visit Reverts the virtual loss of several rollouts and applies the value for each of them
+     * @param childIdx Index to the child node to update
+     * @param value Specifies the value evaluation to backpropagate
+     * @param virtualLoss Virtual loss which was applied on the way down by each rollout
+     * @param multiplicity Number of rollouts
+     */
+    void revert_virtual_loss_and_update_multi_visit(size_t childIdx, float value, float virtualLoss, float multiplicity);
 
     /**
      * @brief backup_collision Iteratively removes the virtual loss of the collision event that occured
      * @param childIdx Index to the child node to update
+     * @param virtualLoss Virtual loss which was applied on the way down
      */
-    void backup_collision(size_t childIdx);
+    void backup_collision(size_t childIdx, float virtualLoss);
 
     /**
      * @brief revert_virtual_loss Reverts the virtual loss for a target node
      * @param childIdx Index to the child node to update
+     * @param virtualLoss Virtual loss which was applied on the way down
      */
-    void revert_virtual_loss(size_t childIdx);
+    void revert_virtual_loss(size_t childIdx, float virtualLoss);
 
     Move get_move(size_t childIdx) const;
-    vector<Node*> get_child_nodes() const;
+    Span<Node* const> get_child_nodes() const;
     bool is_terminal() const;
     bool has_nn_results() const;
     Color side_to_move() const;
     Board* get_pos() const;
+
+    /**
+     * @brief set_pos Sets the board position of this node. The previous position isn't freed.
+     * Setting a nullptr is used to detach a working board which was only borrowed for the construction of the node.
+     * @param value New board position or nullptr
+     */
+    void set_pos(Board* value);
+    int get_plies_from_null() const;
+    int get_rule50() const;
     float get_value() const;
 
-    void apply_virtual_loss_to_child(size_t childIdx);
+    /**
+     * @brief apply_virtual_loss_to_child Temporarily reduces the attraction of the given child node until the rollout is backed up
+     * @param childIdx Index to the child node to update
+     * @param virtualLoss Virtual loss to apply (can differ between the search threads)
+     */
+    void apply_virtual_loss_to_child(size_t childIdx, float virtualLoss);
 
     void revert_virtual_loss_and_update(float value);
     Node* get_parent_node() const;
@@ -220,14 +274,21 @@ public:
 
     DynamicVector<float>& get_policy_prob_small();
 
-    void set_probabilities_for_moves(const float *data, unordered_map<Move, size_t>& moveLookup);
-
-    void apply_softmax_to_policy();
+    /**
+     * @brief set_probabilities_for_moves Sets the prior policy for all legal moves given the raw policy output of the neural network.
+     * The gather, softmax and temperature scaling are done in a single pass (see get_probs_of_moves_with_temperature()).
+     * @param data Pointer to the policy output of the corresponding batch index
+     * @param moveLookup Look-up table for the current side to move
+     * @param isPolicyMap Sets if the policy is encoded in policy map representation
+     * @param temperature Temperature which is applied to the prior policy
+     */
+    void set_probabilities_for_moves(const float *data, const unordered_map<Move, size_t>& moveLookup, bool isPolicyMap, float temperature);
 
     /**
      * @brief enhance_moves Calls enhance_checks & enchance captures if the searchSetting suggests it and applies a renormilization afterwards
+     * @param nodePos Board position of this node, which is passed explicitly because the node might not store its own position
      */
-    void enhance_moves();
+    void enhance_moves(const Board* nodePos);
 
     void set_value(float value);
     size_t get_child_idx_for_parent() const;
@@ -237,7 +298,7 @@ public:
     /**
      * @brief add_transposition_child_node Copies the node with the NN evaluation based on a preexisting node
      * @param it Iterator which from the hash table
-     * @param newPos Board position which belongs to the node
+     * @param newPos Board position which belongs to the node (nullptr if positions are reconstructed during search)
      * @param parentNode Parent node of the new node
      * @param childIdx Index on how to visit the child node from its parent
      */
@@ -260,7 +321,7 @@ public:
      * @return float
      */
     float updated_value_eval();
-    std::vector<Move> get_legal_moves() const;
+    Span<const Move> get_legal_moves() const;
     int get_checkmate_idx() const;
 
     /**
@@ -279,6 +340,26 @@ public:
      */
     void get_principal_variation(vector<Move>& pv) const;
 
+    /**
+     * @brief get_principal_variation Returns the principal variation which starts with the given child move
+     * @param childIdx Index of the first move of the variation
+     * @param pv Vector in which moves will be pushed.
+     */
+    void get_principal_variation(size_t childIdx, vector<Move>& pv) const;
+
+    /**
+     * @brief get_best_child_indices Returns the indices of the (up to) k best visited child nodes ordered by the get_mcts_policy() criterion.
+     * Only visited child nodes are returned, but at least one index is returned if there is any child node.
+     * @param k Maximum number of indices
+     * @param indices Output vector for the indices
+     */
+    void get_best_child_indices(size_t k, vector<size_t>& indices) const;
+
+    /**
+     * @brief get_q_value Returns the current Q-value of the given child node
+     */
+    float get_q_value(size_t childIdx) const;
+
     /**
      * @brief mark_nodes_as_fully_expanded Sets the noVisitIdx to be the number of child nodes.
      * This method should be called for instance after applying dirichlet noise,
@@ -295,6 +376,12 @@ public:
     friend std::ostream& operator<<(std::ostream& os, const Node* node);
     DynamicVector<float> get_child_number_visits() const;
     void enable_has_nn_results();
+
+    /**
+     * @brief get_statistic_bytes Returns the number of heap bytes which are allocated by the policy, visits, action value and q-value vectors
+     * @return size_t
+     */
+    size_t get_statistic_bytes() const;
 };
 
 // https://stackoverflow.com/questions/6339970/c-using-function-as-parameter
@@ -309,11 +396,23 @@ inline bool isCapture(const Board* pos, Move move);
  * @param threshCheck Probability threshold for checking moves
  * @return bool
 */
-inline bool enhance_move_type(float increment, float thresh, const Board* pos, const vector<Move>& legalMoves,
+inline bool enhance_move_type(float increment, float thresh, const Board* pos, Span<const Move> legalMoves,
                               vFunctionMoveType func, DynamicVector<float>& policyProbSmall);
 
 Node* select_child_node(Node* node);
 
+/**
+ * @brief count_allocations Adds heap allocations of the tree (nodes, positions and node statistics) to the counter of the calling thread
+ * @param number Number of allocations
+ */
+void count_allocations(size_t number);
+
+/**
+ * @brief get_thread_allocations Returns the number of counted heap allocations of the calling thread
+ * @return size_t
+ */
+size_t get_thread_allocations();
+
 /**
  * @brief delete_subtree Deletes the node itself and its pointer in the hashtable as well as all existing nodes in its subtree.
  * @param node Node of the subtree to delete
@@ -39,6 +39,7 @@ void OptionsUCI::init(OptionsMap &o)
     o["Device_ID"]                     << Option(0, 0, 99999);
     o["Batch_Size"]                    << Option(16, 1, 8192);
     o["Threads"]                       << Option(2, 1, 512);
+    o["Post_Processing_Threads"]       << Option(0, 0, 512);
     o["Centi_CPuct_Init"]              << Option(250, 1, 99999);
     o["CPuct_Base"]                    << Option(19652, 1, 99999);
     o["Centi_Dirichlet_Epsilon"]       << Option(0, 0, 99999);
@@ -57,12 +58,22 @@ void OptionsUCI::init(OptionsMap &o)
     o["Centi_Temperature_Decay"]       << Option(92, 0, 100);
     o["Centi_Node_Temperature"]        << Option(200, 1, 99999);
     o["Virtual_Loss"]                  << Option(3, 0, 99999);
+    o["Adaptive_Virtual_Loss"]         << Option(false);
+    o["Multi_Visit_Collisions"]        << Option(false);
+    o["Allocation_Statistics"]         << Option(false);
     o["Nodes"]                         << Option(1500000, 0, 99999999);
     o["Allow_Early_Stopping"]          << Option(true);
+    o["Ponder"]                        << Option(false);
+    o["Info_Interval"]                 << Option(1000, 0, 99999);
+    o["Hash_Full_Nodes"]               << Option(1000000, 1, 99999999);
+    o["MultiPV"]                       << Option(1, 1, 500);
+    o["Dynamic_Time_Manager"]          << Option(false);
+    o["Time_Trace_File"]               << Option("<empty>");
     o["Use_Raw_Network"]               << Option(false);
 //    o["Enhance_Checks"]                << Option(true);                currently disabled
 //    o["Enhance_Captures"]              << Option(false);               currently disabled
     o["Use_Transposition_Table"]       << Option(true);
+    o["Reconstruct_Positions"]         << Option(false);
 #ifdef TENSORRT
     o["Use_TensorRT"]                  << Option(true);
 #endif
@@ -71,7 +82,22 @@ void OptionsUCI::init(OptionsMap &o)
     o["Model_Directory_Contender"]     << Option("model_contender/");
     o["Selfplay_Number_Chunks"]        << Option(640, 1, 99999);
     o["Selfplay_Chunk_Size"]           << Option(128, 1, 99999);
+    o["Selfplay_Sparse_Policy"]        << Option(false);
+    o["Selfplay_Pack_Planes"]          << Option(false);
+    o["Selfplay_Rotate_Shards"]        << Option(false);
+    o["Selfplay_Resume_Export"]        << Option(false);
+    o["Selfplay_Reuse_Tree"]           << Option(true);
+    o["Selfplay_Parallel_Games"]       << Option(1, 1, 512);
+    o["Selfplay_Flush_Timeout"]        << Option(1000, 1, 1000000);
+    o["Arena_SPRT"]                    << Option(false);
+    o["Arena_SPRT_Elo0"]               << Option(0, -1000, 1000);
+    o["Arena_SPRT_Elo1"]               << Option(20, -1000, 1000);
+    o["Centi_Arena_SPRT_Alpha"]        << Option(5, 1, 49);
+    o["Centi_Arena_SPRT_Beta"]         << Option(5, 1, 49);
     o["Centi_Raw_Prob_Temperature"]    << Option(25, 0, 100);
+    o["Selfplay_Opening_Pool_Size"]    << Option(0, 0, 1000000);
+    o["Selfplay_Opening_Pool_Batch"]   << Option(64, 1, 4096);
+    o["Selfplay_Opening_Pool_Refill"]  << Option(true);
     o["Milli_Policy_Clip_Thresh"]      << Option(0, 0, 100);
     o["MeanInitPly"]                   << Option(15, 0, 99999);
     o["MaxInitPly"]                    << Option(30, 0, 99999);
@@ -79,6 +105,7 @@ void OptionsUCI::init(OptionsMap &o)
     o["Centi_Quick_Probability"]       << Option(0, 0, 100);
     o["Centi_Quick_Q_Value_Weight"]    << Option(70, 0, 99999);
     o["Centi_Quick_Dirichlet_Epsilon"] << Option(0, 0, 99999);
+    o["Centi_Quick_Sample_Weight"]     << Option(0, 0, 100);
     o["Centi_Node_Random_Factor"]      << Option(10, 0, 100);
 #endif
     o["Move_Overhead"]                 << Option(50, 0, 5000);
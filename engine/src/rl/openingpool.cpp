@@ -0,0 +1,309 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: openingpool.cpp
+ * Created on 19.10.2026
+ * @author: queensgambit
+ */
+
+#ifdef USE_RL
+#include "openingpool.h"
+#include <fstream>
+#include <sstream>
+#include "uci.h"
+#include "thread.h"
+#include "selfplay.h"
+#include "../domain/variants.h"
+#include "../domain/crazyhouse/inputrepresentation.h"
+#include "../domain/crazyhouse/outputrepresentation.h"
+#include "../util/blazeutil.h"
+#include "../util/randomgen.h"
+
+// opening which is currently generated in a slot of the mini-batch
+struct OpeningLine
+{
+    Board* position;
+    StatesManager states;
+    vector<Move> moves;
+    vector<Move> legalMoves;
+    size_t plies;
+};
+
+void clear_line(OpeningLine& line)
+{
+    if (line.position != nullptr) {
+        line.states.swap_states();
+        line.states.clear_states();
+        line.position->set_state_info(new StateInfo);
+        delete line.position;
+        line.position = nullptr;
+    }
+    line.moves.clear();
+}
+
+OpeningPool::OpeningPool(NeuralNetAPI* net, size_t batchSize, Variant variant, PlaySettings* playSettings, float rawPolicyProbTemp,
+                         size_t capacity, bool refill, const string& fileName):
+    net(net), batchSize(batchSize), variant(variant), playSettings(playSettings), rawPolicyProbTemp(rawPolicyProbTemp),
+    capacity(capacity), refill(refill), fileName(fileName), refillPending(false), refillPool(new WorkerPool(1))
+{
+    inputPlanes = new float[batchSize * NB_VALUES_TOTAL];
+    fill_n(inputPlanes, batchSize * NB_VALUES_TOTAL, 0.0f);
+    valueOutputs = new NDArray(Shape(batchSize, 1), Context::cpu());
+    probOutputs = new NDArray(Shape(batchSize, net->is_policy_map() ? NB_LABELS_POLICY_MAP : NB_LABELS), Context::cpu());
+}
+
+OpeningPool::~OpeningPool()
+{
+    // the refill task uses the network and the output buffers
+    refillPool->wait_all();
+    delete refillPool;
+    delete [] inputPlanes;
+    delete valueOutputs;
+    delete probOutputs;
+}
+
+size_t OpeningPool::sample_number_plies() const
+{
+    const size_t ply = size_t(random_exponential<float>(1.0f/playSettings->meanInitPly) + 0.5f);
+    return clip_ply(ply, playSettings->maxInitPly);
+}
+
+vector<vector<Move>> OpeningPool::generate_openings(size_t numberOpenings)
+{
+    vector<vector<Move>> newOpenings;
+    newOpenings.reserve(numberOpenings);
+    vector<OpeningLine> lines(batchSize);
+    size_t startedLines = 0;
+    for (OpeningLine& line : lines) {
+        line.position = nullptr;
+    }
+
+    while (newOpenings.size() < numberOpenings) {
+        // finish the lines which have reached their length and start new ones in their slots
+        for (OpeningLine& line : lines) {
+            if (line.position != nullptr && line.moves.size() < line.plies) {
+                continue;
+            }
+            if (line.position != nullptr) {
+                newOpenings.push_back(line.moves);
+                clear_line(line);
+            }
+            if (startedLines < numberOpenings) {
+                line.position = init_board(variant, &line.states);
+                line.plies = sample_number_plies();
+                ++startedLines;
+            }
+        }
+
+        // evaluate the current positions of all open lines in a single mini-batch
+        size_t batchIdx = 0;
+        for (OpeningLine& line : lines) {
+            if (line.position != nullptr && line.moves.size() < line.plies) {
+                board_to_planes(line.position, line.position->number_repetitions(), true, inputPlanes + batchIdx * NB_VALUES_TOTAL);
+            }
+            ++batchIdx;
+        }
+        net->predict(inputPlanes, *valueOutputs, *probOutputs);
+
+        batchIdx = 0;
+        for (OpeningLine& line : lines) {
+            if (line.position != nullptr && line.moves.size() < line.plies) {
+                line.legalMoves.clear();
+                for (const ExtMove& move : MoveList<LEGAL>(*line.position)) {
+                    line.legalMoves.push_back(move);
+                }
+                EvalInfo eval;
+                eval.policyProbSmall.resize(line.legalMoves.size());
+                get_probs_of_move_list(batchIdx, probOutputs, line.legalMoves, line.position->side_to_move(),
+                                       !net->is_policy_map(), eval.policyProbSmall, net->is_policy_map());
+                apply_raw_policy_temp(eval, rawPolicyProbTemp);
+                const Move move = line.legalMoves[random_choice(eval.policyProbSmall)];
+
+                if (leads_to_terminal(*line.position, move)) {
+                    // the opening is finished early, so the game won't start in a terminal position
+                    line.plies = line.moves.size();
+                }
+                else {
+                    StateInfo* newState = new StateInfo;
+                    line.states.activeStates.push_back(newState);
+                    line.position->do_move(move, *(newState));
+                    line.moves.push_back(move);
+                }
+            }
+            ++batchIdx;
+        }
+    }
+
+    for (OpeningLine& line : lines) {
+        clear_line(line);
+    }
+    return newOpenings;
+}
+
+void OpeningPool::refill_pool()
+{
+    size_t numberMissing;
+    {
+        lock_guard<mutex> lock(mtx);
+        numberMissing = capacity - openings.size();
+    }
+    vector<vector<Move>> newOpenings = generate_openings(numberMissing);
+    {
+        lock_guard<mutex> lock(mtx);
+        openings.insert(openings.end(), newOpenings.begin(), newOpenings.end());
+        refillPending = false;
+    }
+    // a restarted self play continues with the current pool instead of generating it again
+    save();
+}
+
+bool OpeningPool::load()
+{
+    ifstream poolFile(fileName);
+    if (!poolFile.is_open()) {
+        return false;
+    }
+    string line;
+    // the first line stores the model which generated the openings
+    if (!getline(poolFile, line) || line != "model " + net->get_model_name()) {
+        cout << "Opening pool " << fileName << " was generated by a different model" << endl;
+        return false;
+    }
+    vector<Move> opening;
+    lock_guard<mutex> lock(mtx);
+    openings.clear();
+    while (getline(poolFile, line) && openings.size() < capacity) {
+        if (opening_from_string(line, variant, opening)) {
+            openings.push_back(opening);
+        }
+    }
+    return !openings.empty();
+}
+
+void OpeningPool::save()
+{
+    lock_guard<mutex> lock(mtx);
+    ofstream poolFile(fileName);
+    poolFile << "model " << net->get_model_name() << endl;
+    for (const vector<Move>& opening : openings) {
+        poolFile << opening_to_string(opening) << endl;
+    }
+}
+
+void OpeningPool::fill()
+{
+    if (load()) {
+        cout << "Loaded " << size() << " openings from " << fileName << endl;
+    }
+    else {
+        refill_pool();
+        cout << "Generated " << size() << " openings in " << fileName << endl;
+    }
+}
+
+Board* OpeningPool::init_starting_pos(GamePGN& gamePGN, StatesManager* states)
+{
+    vector<Move> opening;
+    bool found = false;
+    while (!found) {
+        unique_lock<mutex> lock(mtx);
+        if (!openings.empty()) {
+            found = true;
+            const size_t openingIdx = random_index(openings.size());
+            opening = openings[openingIdx];
+            if (refill) {
+                openings[openingIdx] = openings.back();
+                openings.pop_back();
+            }
+        }
+        if (refill && !refillPending && openings.size() <= capacity / 2) {
+            refillPending = true;
+            refillPool->enqueue([this]{ refill_pool(); });
+        }
+        if (!found) {
+            // all openings are used up, the game waits for the refill
+            lock.unlock();
+            refillPool->wait_all();
+        }
+    }
+
+    Board* position = init_board(variant, states);
+    for (Move move : opening) {
+        vector<Move> legalMoves;
+        for (const ExtMove& legalMove : MoveList<LEGAL>(*position)) {
+            legalMoves.push_back(legalMove);
+        }
+        gamePGN.gameMoves.push_back(pgn_move(move,
+                                             false,
+                                             *position,
+                                             legalMoves,
+                                             false,
+                                             true));
+        StateInfo* newState = new StateInfo;
+        states->activeStates.push_back(newState);
+        position->do_move(move, *(newState));
+    }
+    return position;
+}
+
+size_t OpeningPool::size()
+{
+    lock_guard<mutex> lock(mtx);
+    return openings.size();
+}
+
+string opening_to_string(const vector<Move>& opening)
+{
+    string line;
+    for (Move move : opening) {
+        if (!line.empty()) {
+            line += " ";
+        }
+        line += UCI::move(move, false);
+    }
+    return line;
+}
+
+bool opening_from_string(const string& line, Variant variant, vector<Move>& opening)
+{
+    opening.clear();
+    StatesManager states;
+    Board* position = init_board(variant, &states);
+    istringstream is(line);
+    string token;
+    bool isValid = true;
+    while (is >> token) {
+        const Move move = UCI::to_move(*position, token);
+        if (move == MOVE_NONE || leads_to_terminal(*position, move)) {
+            isValid = false;
+            break;
+        }
+        StateInfo* newState = new StateInfo;
+        states.activeStates.push_back(newState);
+        position->do_move(move, *(newState));
+        opening.push_back(move);
+    }
+    states.swap_states();
+    states.clear_states();
+    position->set_state_info(new StateInfo);
+    delete position;
+    return isValid;
+}
+#endif
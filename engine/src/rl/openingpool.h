@@ -0,0 +1,155 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: openingpool.h
+ * Created on 19.10.2026
+ * @author: queensgambit
+ *
+ * Pool of precomputed opening lines for self play. The lines are sampled from the raw network policy in mini-batches
+ * instead of a single raw network evaluation per opening ply of every game.
+ * The pool is stored as a text file with one line of UCI moves from the start position per opening.
+ */
+
+#ifndef OPENINGPOOL_H
+#define OPENINGPOOL_H
+
+#ifdef USE_RL
+#include <string>
+#include <vector>
+#include <mutex>
+#include "../board.h"
+#include "../nn/neuralnetapi.h"
+#include "../agents/config/playsettings.h"
+#include "../manager/statesmanager.h"
+#include "../util/workerpool.h"
+#include "gamepgn.h"
+
+using namespace std;
+
+class OpeningPool
+{
+private:
+    NeuralNetAPI* net;
+    // constant batch size of the net
+    size_t batchSize;
+    Variant variant;
+    PlaySettings* playSettings;
+    float rawPolicyProbTemp;
+    // number of openings which are generated for a full pool
+    size_t capacity;
+    // if true, every opening is used once and the pool is refilled in the background when half of it is used up,
+    // otherwise the openings are drawn with replacement
+    bool refill;
+    string fileName;
+    // move sequences from the start position of the variant
+    vector<vector<Move>> openings;
+    // protects the openings and refillPending
+    mutex mtx;
+    bool refillPending;
+    WorkerPool* refillPool;
+    float* inputPlanes;
+    NDArray* valueOutputs;
+    NDArray* probOutputs;
+
+    /**
+     * @brief sample_number_plies Samples the length of a new opening from an exponential distribution with mean
+     * playSettings->meanInitPly which is clipped at playSettings->maxInitPly
+     * @return Number of plies
+     */
+    size_t sample_number_plies() const;
+
+    /**
+     * @brief generate_openings Samples new openings from the raw network policy. Up to batchSize openings are played
+     * at the same time and all of their positions are evaluated in a single prediction.
+     * An opening ends either when its sampled number of plies is reached or when the next move would lead to a terminal state.
+     * @param numberOpenings Number of openings to generate
+     * @return Generated openings
+     */
+    vector<vector<Move>> generate_openings(size_t numberOpenings);
+
+    /**
+     * @brief refill_pool Generates the missing openings of the pool, adds them to the pool and saves the pool file
+     */
+    void refill_pool();
+
+    /**
+     * @brief load Loads the openings of the pool file. The file is ignored if it was generated by a different model.
+     * @return True, if at least one opening was loaded
+     */
+    bool load();
+
+    /**
+     * @brief save Writes the current openings to the pool file
+     */
+    void save();
+
+public:
+    /**
+     * @brief OpeningPool Constructor
+     * @param net Network which is only used by the opening pool. The generation of openings can run in a background thread.
+     * @param batchSize Batch size of the network
+     * @param variant Variant to be played
+     * @param playSettings Play settings which provide the mean and maximum number of opening plies
+     * @param rawPolicyProbTemp Probability for which a temperature scaling > 1.0f is applied
+     * @param capacity Number of openings of a full pool
+     * @param refill If true, every opening is used once and the pool is refilled in the background
+     * @param fileName File name of the pool
+     */
+    OpeningPool(NeuralNetAPI* net, size_t batchSize, Variant variant, PlaySettings* playSettings, float rawPolicyProbTemp,
+                size_t capacity, bool refill, const string& fileName);
+    ~OpeningPool();
+
+    /**
+     * @brief fill Loads the pool file or generates a new pool and saves it if no usable file exists
+     */
+    void fill();
+
+    /**
+     * @brief init_starting_pos Inits a new starting position with a random opening of the pool
+     * and appends the opening moves as book moves to the gamePGN
+     * @param gamePGN Game pgn struct where the moves will be stored
+     * @param states State manager which takes over the newly created state objects
+     * @return New board object
+     */
+    Board* init_starting_pos(GamePGN& gamePGN, StatesManager* states);
+
+    /**
+     * @brief size Returns the number of available openings
+     */
+    size_t size();
+};
+
+/**
+ * @brief opening_to_string Converts an opening into a line of space separated UCI moves
+ */
+string opening_to_string(const vector<Move>& opening);
+
+/**
+ * @brief opening_from_string Parses a line of UCI moves which are played from the start position of the variant
+ * @param line Line of the pool file
+ * @param variant Variant to be played
+ * @param opening Parsed opening
+ * @return False, if a move is illegal or the line leads to a terminal position
+ */
+bool opening_from_string(const string& line, Variant variant, vector<Move>& opening);
+
+#endif
+
+#endif // OPENINGPOOL_H
@@ -33,26 +33,38 @@
 #include "../domain/variants.h"
 #include "../util/blazeutil.h"
 #include "../util/randomgen.h"
+#include "../util/workerpool.h"
+
+ArenaWorker::ArenaWorker(MCTSAgent* producer, MCTSAgent* contender, SearchLimits* searchLimits, StatesManager* states, size_t numberSearchThreads):
+    producer(producer), contender(contender), searchLimits(searchLimits), states(states), numberSearchThreads(numberSearchThreads)
+{
+    init_selfplay_pgn(gamePGN);
+}
+
+SelfPlayWorker::SelfPlayWorker(RawNetAgent* rawAgent, MCTSAgent* mctsAgent, SearchLimits* searchLimits, StatesManager* states, size_t numberSearchThreads):
+    rawAgent(rawAgent), mctsAgent(mctsAgent), searchLimits(searchLimits), states(states), numberSearchThreads(numberSearchThreads)
+{
+    init_selfplay_pgn(gamePGN);
+    gamePGN.white = mctsAgent->get_name();
+    gamePGN.black = mctsAgent->get_name();
+
+    backupNodes = searchLimits->nodes;
+    backupQValueWeight = mctsAgent->get_q_value_weight();
+    backupDirichletEpsilon = mctsAgent->get_dirichlet_noise();
+}
 
 SelfPlay::SelfPlay(RawNetAgent* rawAgent, MCTSAgent* mctsAgent, SearchLimits* searchLimits, PlaySettings* playSettings, RLSettings* rlSettings):
     rawAgent(rawAgent), mctsAgent(mctsAgent), searchLimits(searchLimits), playSettings(playSettings), rlSettings(rlSettings),
-    gameIdx(0), gamesPerMin(0), samplesPerMin(0)
+    openingPool(nullptr), gameIdx(0), generatedSamples(0), gamesPerMin(0), samplesPerMin(0), reusedNodes(0), searchedNodes(0)
 {
-    gamePGN.variant = "crazyhouse";
-    gamePGN.event = "CrazyAra-SelfPlay";
-    gamePGN.site = "Darmstadt, GER";
-    gamePGN.date = "?";  // TODO: Change this later
-    gamePGN.round = "?";
-    gamePGN.is960 = false;
+    init_selfplay_pgn(gamePGN);
     this->exporter = new TrainDataExporter(string("data_") + mctsAgent->get_device_name() + string(".zarr"),
-                                           rlSettings->numberChunks, rlSettings->chunkSize);
+                                           rlSettings->numberChunks, rlSettings->chunkSize,
+                                           rlSettings->sparsePolicy, rlSettings->packPlanes,
+                                           rlSettings->rotateShards, mctsAgent->get_name(), rlSettings->resumeExport);
     filenamePGNSelfplay = string("games_") + mctsAgent->get_device_name() + string(".pgn");
     filenamePGNArena = string("arena_games_")+ mctsAgent->get_device_name() + string(".pgn");
     fileNameGameIdx = string("gameIdx_") + mctsAgent->get_device_name() + string(".txt");
-
-    backupNodes = searchLimits->nodes;
-    backupQValueWeight = mctsAgent->get_q_value_weight();
-    backupDirichletEpsilon = mctsAgent->get_dirichlet_noise();
 }
 
 SelfPlay::~SelfPlay()
@@ -60,6 +72,11 @@ SelfPlay::~SelfPlay()
     delete exporter;
 }
 
+void SelfPlay::set_opening_pool(OpeningPool* openingPool)
+{
+    this->openingPool = openingPool;
+}
+
 void SelfPlay::adjust_node_count(SearchLimits* searchLimits, int randInt)
 {
     size_t maxRandomNodes = size_t(searchLimits->nodes * rlSettings->nodeRandomFactor);
@@ -72,54 +89,80 @@ bool SelfPlay::is_quick_search() {
     if (rlSettings->quickSearchProbability < 0.01f) {
         return false;
     }
-    return float(rand()) / RAND_MAX < rlSettings->quickSearchProbability;
+    return random_uniform(0.0f, 1.0f) < rlSettings->quickSearchProbability;
 }
 
-void SelfPlay::reset_search_params(bool isQuickSearch)
+void SelfPlay::prepare_search_params(SelfPlayWorker& worker, bool isQuickSearch)
 {
-    searchLimits->nodes = backupNodes;
     if (isQuickSearch) {
-        mctsAgent->update_q_value_weight(backupQValueWeight);
-        mctsAgent->update_dirichlet_epsilon(backupDirichletEpsilon);
+        // fast searches continue on the reused tree with less nodes and without exploration noise by default
+        worker.searchLimits->nodes = rlSettings->quickSearchNodes;
+        worker.mctsAgent->update_q_value_weight(rlSettings->quickSearchQValueWeight);
+        worker.mctsAgent->update_dirichlet_epsilon(rlSettings->quickDirichletEpsilon);
     }
 }
 
-void SelfPlay::generate_game(Variant variant, StatesManager* states, bool verbose)
+float SelfPlay::get_sample_weight(bool isQuickSearch) const
 {
-    chrono::steady_clock::time_point gameStartTime = chrono::steady_clock::now();
+    return isQuickSearch ? rlSettings->quickSearchSampleWeight : 1.0f;
+}
 
-    size_t ply = size_t(random_exponential<float>(1.0f/playSettings->meanInitPly) + 0.5f);
-    ply = clip_ply(ply, playSettings->maxInitPly);
+void SelfPlay::reset_search_params(SelfPlayWorker& worker, bool isQuickSearch)
+{
+    worker.searchLimits->nodes = worker.backupNodes;
+    if (isQuickSearch) {
+        worker.mctsAgent->update_q_value_weight(worker.backupQValueWeight);
+        worker.mctsAgent->update_dirichlet_epsilon(worker.backupDirichletEpsilon);
+    }
+}
 
-    srand(unsigned(int(time(nullptr))));
-    Board* position = init_starting_pos_from_raw_policy(*rawAgent, ply, gamePGN, variant, states,
-                                                        rlSettings->rawPolicyProbabilityTemperature);
+void SelfPlay::generate_game(SelfPlayWorker& worker, Variant variant, bool verbose)
+{
+    MCTSAgent* mctsAgent = worker.mctsAgent;
+    SearchLimits* searchLimits = worker.searchLimits;
+    StatesManager* states = worker.states;
+    GamePGN& gamePGN = worker.gamePGN;
+
+    Board* position;
+    if (openingPool != nullptr) {
+        position = openingPool->init_starting_pos(gamePGN, states);
+    }
+    else {
+        size_t ply = size_t(random_exponential<float>(1.0f/playSettings->meanInitPly) + 0.5f);
+        ply = clip_ply(ply, playSettings->maxInitPly);
+        position = init_starting_pos_from_raw_policy(*worker.rawAgent, ply, gamePGN, variant, states,
+                                                     rlSettings->rawPolicyProbabilityTemperature);
+    }
     EvalInfo evalInfo;
     states->swap_states();
     Result gameResult;
-    exporter->new_game();
+    worker.gameBuffer.clear();
 
-    size_t generatedSamples = 0;
+    size_t gameSamples = 0;
+    size_t gameReusedNodes = 0;
+    size_t gameSearchedNodes = 0;
     do {
         searchLimits->startTime = now();
-        const int randInt = rand();
+        const int randInt = int(random_index(size_t(INT_MAX)));
         const bool isQuickSearch = is_quick_search();
-
-        if (isQuickSearch) {
-            searchLimits->nodes = rlSettings->quickSearchNodes;
-            mctsAgent->update_q_value_weight(rlSettings->quickSearchQValueWeight);
-            mctsAgent->update_dirichlet_epsilon(rlSettings->quickDirichletEpsilon);
-        }
+        prepare_search_params(worker, isQuickSearch);
         adjust_node_count(searchLimits, randInt);
         mctsAgent->perform_action(position, searchLimits, evalInfo);
-        mctsAgent->apply_move_to_tree(evalInfo.bestMove, true, position);
+        if (rlSettings->reuseTree) {
+            mctsAgent->reuse_child_as_next_root(evalInfo.bestMove);
+        }
+        // the visits of the reused subtree didn't require any new neural network evaluations
+        gameReusedNodes += evalInfo.nodesPreSearch;
+        gameSearchedNodes += evalInfo.nodes;
 
-        if (!isQuickSearch && !exporter->is_file_full()) {
+        // full searches are exported with a weight of 1, fast searches only if they have a positive sample weight
+        const float sampleWeight = get_sample_weight(isQuickSearch);
+        if (sampleWeight > 0 && !exporter->is_file_full()) {
             if (rlSettings->lowPolicyClipThreshold > 0) {
                 sharpen_distribution(evalInfo.policyProbSmall, rlSettings->lowPolicyClipThreshold);
             }
-            exporter->save_sample(position, evalInfo);
-            ++generatedSamples;
+            exporter->save_sample(worker.gameBuffer, position, evalInfo, sampleWeight);
+            ++gameSamples;
         }
         StateInfo* newState = new StateInfo;
         states->activeStates.push_back(newState);
@@ -130,27 +173,28 @@ void SelfPlay::generate_game(Variant variant, StatesManager* states, bool verbos
                                             *mctsAgent->get_root_node()->get_pos(),
                                             evalInfo.legalMoves,
                                             is_win(gameResult)));
-        reset_search_params(isQuickSearch);
+        reset_search_params(worker, isQuickSearch);
     }
     while(gameResult == NO_RESULT);
 
     // export all training samples of the generated game
-    exporter->export_game_samples(gameResult);
+    exporter->export_game_samples(worker.gameBuffer, gameResult);
 
-    set_game_result_to_pgn(gameResult);
-    write_game_to_pgn(filenamePGNSelfplay, verbose);
+    set_game_result_to_pgn(gamePGN, gameResult);
+    write_game_to_pgn(filenamePGNSelfplay, gamePGN, verbose);
     clean_up(gamePGN, mctsAgent, states, position);
 
     // measure time statistics
-    if (verbose) {
-        const float elapsedTimeMin = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - gameStartTime).count() / 60000.f;
-        speed_statistic_report(elapsedTimeMin, generatedSamples);
-    }
-    ++gameIdx;
+    speed_statistic_report(gameSamples, gameReusedNodes, gameSearchedNodes, verbose);
 }
 
-Result SelfPlay::generate_arena_game(MCTSAgent* whitePlayer, MCTSAgent* blackPlayer, Variant variant, StatesManager* states, bool verbose)
+Result SelfPlay::generate_arena_game(ArenaWorker& worker, bool contenderIsWhite, Variant variant,
+                                     BatchDispatcher* producerDispatcher, BatchDispatcher* contenderDispatcher, bool verbose)
 {
+    MCTSAgent* whitePlayer = contenderIsWhite ? worker.contender : worker.producer;
+    MCTSAgent* blackPlayer = contenderIsWhite ? worker.producer : worker.contender;
+    StatesManager* states = worker.states;
+    GamePGN& gamePGN = worker.gamePGN;
     gamePGN.white = whitePlayer->get_name();
     gamePGN.black = blackPlayer->get_name();
     Board* position = init_board(variant, states);
@@ -162,7 +206,7 @@ Result SelfPlay::generate_arena_game(MCTSAgent* whitePlayer, MCTSAgent* blackPla
     states->swap_states();
     Result gameResult;
     do {
-        searchLimits->startTime = now();
+        worker.searchLimits->startTime = now();
         if (position->side_to_move() == WHITE) {
             activePlayer = whitePlayer;
             passivePlayer = blackPlayer;
@@ -171,7 +215,15 @@ Result SelfPlay::generate_arena_game(MCTSAgent* whitePlayer, MCTSAgent* blackPla
             activePlayer = blackPlayer;
             passivePlayer = whitePlayer;
         }
-        activePlayer->perform_action(position, searchLimits, evalInfo);
+        // only the network of the active player receives requests of this game
+        BatchDispatcher* activeDispatcher = activePlayer == worker.contender ? contenderDispatcher : producerDispatcher;
+        if (activeDispatcher != nullptr) {
+            activeDispatcher->add_requesters(worker.numberSearchThreads);
+        }
+        activePlayer->perform_action(position, worker.searchLimits, evalInfo);
+        if (activeDispatcher != nullptr) {
+            activeDispatcher->remove_requesters(worker.numberSearchThreads);
+        }
         activePlayer->apply_move_to_tree(evalInfo.bestMove, true, position);
         if (position->plies_from_null() != 0) {
             passivePlayer->apply_move_to_tree(evalInfo.bestMove, false, position);
@@ -187,8 +239,8 @@ Result SelfPlay::generate_arena_game(MCTSAgent* whitePlayer, MCTSAgent* blackPla
                                             is_win(gameResult)));
     }
     while(gameResult == NO_RESULT);
-    set_game_result_to_pgn(gameResult);
-    write_game_to_pgn(filenamePGNArena, verbose);
+    set_game_result_to_pgn(gamePGN, gameResult);
+    write_game_to_pgn(filenamePGNArena, gamePGN, verbose);
     clean_up(gamePGN, whitePlayer, states, position);
     blackPlayer->clear_game_history();
     return gameResult;
@@ -203,8 +255,9 @@ void clean_up(GamePGN& gamePGN, MCTSAgent* mctsAgent, StatesManager* states, Boa
     delete position;
 }
 
-void SelfPlay::write_game_to_pgn(const std::string& pngFileName, bool verbose)
+void SelfPlay::write_game_to_pgn(const std::string& pngFileName, const GamePGN& gamePGN, bool verbose)
 {
+    lock_guard<mutex> lock(mtx);
     ofstream pgnFile;
     pgnFile.open(pngFileName, std::ios_base::app);
     if (verbose) {
@@ -214,7 +267,7 @@ void SelfPlay::write_game_to_pgn(const std::string& pngFileName, bool verbose)
     pgnFile.close();
 }
 
-void SelfPlay::set_game_result_to_pgn(Result res)
+void SelfPlay::set_game_result_to_pgn(GamePGN& gamePGN, Result res)
 {
     gamePGN.result = result[res];
 }
@@ -222,22 +275,39 @@ void SelfPlay::set_game_result_to_pgn(Result res)
 void SelfPlay::reset_speed_statistics()
 {
     gameIdx = 0;
+    generatedSamples = 0;
+    reusedNodes = 0;
+    searchedNodes = 0;
+    startTime = chrono::steady_clock::now();
     gamesPerMin = 0;
     samplesPerMin = 0;
 }
 
-void SelfPlay::speed_statistic_report(float elapsedTimeMin, size_t generatedSamples)
+void SelfPlay::speed_statistic_report(size_t gameSamples, size_t gameReusedNodes, size_t gameSearchedNodes, bool verbose)
 {
-    // compute running cummulative average
-    gamesPerMin = (gameIdx * gamesPerMin + (1 / elapsedTimeMin)) / (gameIdx + 1);
-    samplesPerMin = (gameIdx * samplesPerMin + (generatedSamples / elapsedTimeMin)) / (gameIdx + 1);
+    lock_guard<mutex> lock(mtx);
+    ++gameIdx;
+    generatedSamples += gameSamples;
+    reusedNodes += gameReusedNodes;
+    searchedNodes += gameSearchedNodes;
+    const float elapsedTimeMin = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count() / 60000.f;
+    gamesPerMin = gameIdx / elapsedTimeMin;
+    samplesPerMin = generatedSamples / elapsedTimeMin;
+    if (!verbose) {
+        return;
+    }
 
-    cout << "    games    |  games/min  | samples/min " << endl
-         << "-------------+-------------+-------------" << endl
+    // the reused visits didn't require a neural network evaluation
+    const size_t evaluations = searchedNodes - reusedNodes;
+    cout << "    games    |  games/min  | samples/min |reused nodes | saved evals/game | samples/eval" << endl
+         << "-------------+-------------+-------------+-------------+------------------+-------------" << endl
          << std::setprecision(5)
          << setw(13) << gameIdx << '|'
          << setw(13) << gamesPerMin << '|'
-         << setw(13) << samplesPerMin << endl << endl;
+         << setw(13) << samplesPerMin << '|'
+         << setw(13) << (searchedNodes == 0 ? 0.0f : float(reusedNodes) / searchedNodes) << '|'
+         << setw(18) << float(reusedNodes) / gameIdx << '|'
+         << setw(13) << (evaluations == 0 ? 0.0f : float(generatedSamples) / evaluations) << endl << endl;
 }
 
 void SelfPlay::export_number_generated_games() const
@@ -252,54 +322,122 @@ void SelfPlay::export_number_generated_games() const
 void SelfPlay::go(size_t numberOfGames, StatesManager* states)
 {
     reset_speed_statistics();
-    gamePGN.white = mctsAgent->get_name();
-    gamePGN.black = mctsAgent->get_name();
+    SelfPlayWorker worker(rawAgent, mctsAgent, searchLimits, states, 1);
 
     if (numberOfGames == 0) {
         while(!exporter->is_file_full()) {
-            generate_game(CRAZYHOUSE_VARIANT, states, true);
+            generate_game(worker, CRAZYHOUSE_VARIANT, true);
         }
     }
     else {
         for (size_t idx = 0; idx < numberOfGames; ++idx) {
-            generate_game(CRAZYHOUSE_VARIANT, states, true);
+            generate_game(worker, CRAZYHOUSE_VARIANT, true);
         }
     }
     export_number_generated_games();
 }
 
+void SelfPlay::go_parallel(size_t numberOfGames, const vector<SelfPlayWorker*>& workers, BatchDispatcher* dispatcher)
+{
+    reset_speed_statistics();
+    atomic<size_t> nextGameIdx(0);
+    WorkerPool gamePool(workers.size());
+
+    for (SelfPlayWorker* worker : workers) {
+        gamePool.enqueue([this, worker, dispatcher, numberOfGames, &nextGameIdx]{
+            dispatcher->add_requesters(worker->numberSearchThreads);
+            while (numberOfGames == 0 ? !exporter->is_file_full() : nextGameIdx++ < numberOfGames) {
+                generate_game(*worker, CRAZYHOUSE_VARIANT, true);
+            }
+            // the remaining games mustn't wait for requests of this worker anymore
+            dispatcher->remove_requesters(worker->numberSearchThreads);
+        });
+    }
+    gamePool.wait_all();
+    cout << "Dispatched batches:\t" << dispatcher->get_number_batches() << endl;
+    if (dispatcher->get_number_batches() != 0) {
+        cout << "Batch fill:\t\t" << float(dispatcher->get_number_positions()) /
+                (dispatcher->get_number_batches() * dispatcher->get_total_batch_size()) << endl;
+    }
+    export_number_generated_games();
+}
+
+bool SelfPlay::add_arena_result(TournamentResult& tournamentResult, Result gameResult, bool contenderIsWhite)
+{
+    lock_guard<mutex> lock(mtx);
+    if (gameResult == DRAWN) {
+        ++tournamentResult.numberDraws;
+    }
+    else if ((gameResult == WHITE_WIN) == contenderIsWhite) {
+        ++tournamentResult.numberWins;
+    }
+    else {
+        ++tournamentResult.numberLosses;
+    }
+    if (!rlSettings->arenaSPRT) {
+        return false;
+    }
+    const SPRTDecision decision = tournamentResult.sprt(rlSettings->sprtElo0, rlSettings->sprtElo1,
+                                                        rlSettings->sprtAlpha, rlSettings->sprtBeta);
+    cout << "Arena: " << tournamentResult << " LLR: " << tournamentResult.log_likelihood_ratio(rlSettings->sprtElo0, rlSettings->sprtElo1) << endl;
+    return decision != SPRT_CONTINUE;
+}
+
 TournamentResult SelfPlay::go_arena(MCTSAgent *mctsContender, size_t numberOfGames, StatesManager* states)
 {
     TournamentResult tournamentResult;
     tournamentResult.playerA = mctsContender->get_name();
     tournamentResult.playerB = mctsAgent->get_name();
-    Result gameResult;
+    ArenaWorker worker(mctsAgent, mctsContender, searchLimits, states, 1);
     for (size_t idx = 0; idx < numberOfGames; ++idx) {
-        if (idx % 2 == 0) {
-            gameResult = generate_arena_game(mctsContender, mctsAgent, CRAZYHOUSE_VARIANT, states, true);
-            if (gameResult == WHITE_WIN) {
-                ++tournamentResult.numberWins;
-            }
-            else {
-                ++tournamentResult.numberLosses;
-            }
+        const bool contenderIsWhite = idx % 2 == 0;
+        const Result gameResult = generate_arena_game(worker, contenderIsWhite, CRAZYHOUSE_VARIANT, nullptr, nullptr, true);
+        if (add_arena_result(tournamentResult, gameResult, contenderIsWhite)) {
+            break;
         }
-        else {
-            gameResult = generate_arena_game(mctsAgent, mctsContender, CRAZYHOUSE_VARIANT, states, true);
-            if (gameResult == BLACK_WIN) {
-                ++tournamentResult.numberWins;
-            }
-            else {
-                ++tournamentResult.numberLosses;
+    }
+    return tournamentResult;
+}
+
+TournamentResult SelfPlay::go_arena_parallel(size_t numberOfGames, const vector<ArenaWorker*>& workers,
+                                             BatchDispatcher* producerDispatcher, BatchDispatcher* contenderDispatcher)
+{
+    TournamentResult tournamentResult;
+    tournamentResult.playerA = workers.front()->contender->get_name();
+    tournamentResult.playerB = workers.front()->producer->get_name();
+    atomic<size_t> nextGameIdx(0);
+    // set as soon as the SPRT has reached a decision, the games which are still running are finished and counted
+    atomic<bool> decided(false);
+    WorkerPool gamePool(workers.size());
+
+    for (ArenaWorker* worker : workers) {
+        gamePool.enqueue([this, worker, producerDispatcher, contenderDispatcher, numberOfGames, &nextGameIdx, &decided, &tournamentResult]{
+            size_t gameIdx;
+            while (!decided && (gameIdx = nextGameIdx++) < numberOfGames) {
+                // the colors alternate between the games, so both players have the same number of white games
+                const bool contenderIsWhite = gameIdx % 2 == 0;
+                const Result gameResult = generate_arena_game(*worker, contenderIsWhite, CRAZYHOUSE_VARIANT,
+                                                              producerDispatcher, contenderDispatcher, false);
+                if (add_arena_result(tournamentResult, gameResult, contenderIsWhite)) {
+                    decided = true;
+                }
             }
-        }
-        if (gameResult == DRAWN) {
-            ++tournamentResult.numberDraws;
-        }
+        });
     }
+    gamePool.wait_all();
     return tournamentResult;
 }
 
+void init_selfplay_pgn(GamePGN& gamePGN)
+{
+    gamePGN.variant = "crazyhouse";
+    gamePGN.event = "CrazyAra-SelfPlay";
+    gamePGN.site = "Darmstadt, GER";
+    gamePGN.date = "?";  // TODO: Change this later
+    gamePGN.round = "?";
+    gamePGN.is960 = false;
+}
+
 Board* init_board(Variant variant, StatesManager* states)
 {
     Board* position = new Board();
@@ -344,16 +482,16 @@ Board* init_starting_pos_from_raw_policy(RawNetAgent &rawAgent, size_t plys, Gam
 size_t clip_ply(size_t ply, size_t maxPly)
 {
     if (ply > maxPly) {
-        return size_t(rand()) % maxPly;
+        return random_index(maxPly);
     }
     return ply;
 }
 
 void apply_raw_policy_temp(EvalInfo &eval, float rawPolicyProbTemp)
 {
-    if (float(rand()) / RAND_MAX < rawPolicyProbTemp) {
+    if (random_uniform(0.0f, 1.0f) < rawPolicyProbTemp) {
         float temp = 2.0f;
-        const float prob = float(rand()) / INT_MAX;
+        const float prob = random_uniform(0.0f, 1.0f);
         if (prob < 0.05f) {
             temp = 10.0f;
         }
@@ -34,8 +34,46 @@
 #include "../manager/statesmanager.h"
 #include "tournamentresult.h"
 #include "../agents/config/rlsettings.h"
+#include "../nn/batchdispatcher.h"
+#include "openingpool.h"
 
 #ifdef USE_RL
+// agents and game state of a single self play game, several workers can generate games concurrently
+struct SelfPlayWorker
+{
+    RawNetAgent* rawAgent;
+    MCTSAgent* mctsAgent;
+    SearchLimits* searchLimits;
+    // States manager for maintaining the states objects. Used for 3-fold repetition check.
+    StatesManager* states;
+    GamePGN gamePGN;
+    TrainGameBuffer gameBuffer;
+    // number of search threads of the mctsAgent which can send concurrent inference requests
+    size_t numberSearchThreads;
+    // search parameters which are restored after a quick search
+    size_t backupNodes;
+    float backupDirichletEpsilon;
+    float backupQValueWeight;
+
+    SelfPlayWorker(RawNetAgent* rawAgent, MCTSAgent* mctsAgent, SearchLimits* searchLimits, StatesManager* states, size_t numberSearchThreads);
+};
+
+// agents and game state of a single arena game, several workers can play games concurrently
+struct ArenaWorker
+{
+    // agent with the current generator weights
+    MCTSAgent* producer;
+    // agent with the new weights
+    MCTSAgent* contender;
+    SearchLimits* searchLimits;
+    StatesManager* states;
+    GamePGN gamePGN;
+    // number of search threads of each agent which can send concurrent inference requests
+    size_t numberSearchThreads;
+
+    ArenaWorker(MCTSAgent* producer, MCTSAgent* contender, SearchLimits* searchLimits, StatesManager* states, size_t numberSearchThreads);
+};
+
 class SelfPlay
 {
 private:
@@ -46,44 +84,66 @@ private:
     RLSettings* rlSettings;
     GamePGN gamePGN;
     TrainDataExporter* exporter;
+    // precomputed openings, if nullptr the openings are sampled from the raw policy of the rawAgent for every game
+    OpeningPool* openingPool;
     string filenamePGNSelfplay;
     string filenamePGNArena;
     string fileNameGameIdx;
+    // protects the game files and the speed statistics when games are generated concurrently
+    mutex mtx;
     size_t gameIdx;
+    size_t generatedSamples;
+    chrono::steady_clock::time_point startTime;
     float gamesPerMin;
     float samplesPerMin;
-    size_t backupNodes;
-    float backupDirichletEpsilon;
-    float backupQValueWeight;
+    // visits of reused subtrees and all visits of the searched root nodes
+    size_t reusedNodes;
+    size_t searchedNodes;
 
     /**
      * @brief generate_game Generates a new game in self play mode
+     * @param worker Agents and game state which are used for the game
      * @param variant Current chess variant
-     * @param states States manager for maintaining the states objects. Used for 3-fold repetition check.
+     * @param verbose If true the games will printed to stdout
      */
-    void generate_game(Variant variant, StatesManager* states, bool verbose);
+    void generate_game(SelfPlayWorker& worker, Variant variant, bool verbose);
 
     /**
      * @brief generate_arena_game Generates a game of the current NN weights vs the new acquired weights
-     * @param whitePlayer MCTSAgent which will play with the white pieces
-     * @param blackPlayer MCTSAgent which will play with the black pieces
+     * @param worker Agents and game state which are used for the game
+     * @param contenderIsWhite True, if the contender plays with the white pieces
      * @param variant Current chess variant
+     * @param producerDispatcher Dispatcher of the producer network or nullptr if the agents don't use dispatched networks
+     * @param contenderDispatcher Dispatcher of the contender network or nullptr if the agents don't use dispatched networks
      * @param verbose If true the games will printed to stdout
+     * @return Game result
      */
-    Result generate_arena_game(MCTSAgent *whitePlayer, MCTSAgent *blackPlayer, Variant variant, StatesManager* states, bool verbose);
+    Result generate_arena_game(ArenaWorker& worker, bool contenderIsWhite, Variant variant,
+                               BatchDispatcher* producerDispatcher, BatchDispatcher* contenderDispatcher, bool verbose);
+
+    /**
+     * @brief add_arena_result Adds the result of an arena game to the tournament result and runs the SPRT if it is enabled
+     * @param tournamentResult Tournament result in respect to the contender
+     * @param gameResult Game result
+     * @param contenderIsWhite True, if the contender played with the white pieces
+     * @return True, if the SPRT has reached a decision and no further games are needed
+     */
+    bool add_arena_result(TournamentResult& tournamentResult, Result gameResult, bool contenderIsWhite);
 
     /**
      * @brief write_game_to_pgn Writes the game log to a pgn file
      * @param pngFileName Filename to export
+     * @param gamePGN Game which is written
      * @param verbose If true, game will also be printed to stdout
      */
-    void write_game_to_pgn(const std::string& pngFileName, bool verbose);
+    void write_game_to_pgn(const std::string& pngFileName, const GamePGN& gamePGN, bool verbose);
 
     /**
      * @brief set_game_result Sets the game result to the gamePGN object
+     * @param gamePGN Game to which the result is set
      * @param res Game result
      */
-    void set_game_result_to_pgn(Result res);
+    void set_game_result_to_pgn(GamePGN& gamePGN, Result res);
 
     /**
      * @brief reset_speed_statistics Resets the interal measurements for gameIdx, gamesPerMin and samplesPerMin
@@ -91,9 +151,16 @@ private:
     void reset_speed_statistics();
 
     /**
-     * @brief speed_statistic_report Updates the speed statistics and prints a summary to std-out
+     * @brief speed_statistic_report Updates the speed statistics with a finished game and prints a summary to std-out.
+     * The rates refer to the wall clock time since the start of the game generation, so they include all concurrent games.
+     * The reused node fraction is the share of root visits which were carried over from the previous search
+     * and the saved evaluations per game are the number of these visits per game.
+     * @param gameSamples Number of samples which were generated in the finished game
+     * @param gameReusedNodes Sum of the reused visits of all searches in the finished game
+     * @param gameSearchedNodes Sum of the root visits of all searches in the finished game
+     * @param verbose If true, the summary is printed
      */
-    void speed_statistic_report(float elapsedTimeMin, size_t generatedSamples);
+    void speed_statistic_report(size_t gameSamples, size_t gameReusedNodes, size_t gameSearchedNodes, bool verbose);
 
     /**
      * @brief export_number_generated_games Creates a file which describes how many games have been generated in the newly created .zip-file
@@ -114,10 +181,26 @@ private:
     bool is_quick_search();
 
     /**
-     * @brief reset_search_params Resets all search parameters to their initial values
+     * @brief prepare_search_params Applies the search parameters of a fast search (playout cap randomization) to a worker
+     * @param worker Worker of the current game
+     * @param isQuickSearch Signals if a fast search is done, for a full search the parameters remain unchanged
+     */
+    void prepare_search_params(SelfPlayWorker& worker, bool isQuickSearch);
+
+    /**
+     * @brief get_sample_weight Returns the training weight of a sample which is stored in y_sample_weight.
+     * Full searches have a weight of 1 and fast searches the weight Centi_Quick_Sample_Weight. Samples with a weight of 0 aren't exported.
+     * @param isQuickSearch Signals if a fast search was done
+     * @return Sample weight
+     */
+    float get_sample_weight(bool isQuickSearch) const;
+
+    /**
+     * @brief reset_search_params Resets all search parameters of a worker to their initial values
+     * @param worker Worker of the current game
      * @param Signals if a quick search was done
      */
-    void reset_search_params(bool isQuickSearch);
+    void reset_search_params(SelfPlayWorker& worker, bool isQuickSearch);
 
 public:
     /**
@@ -131,21 +214,49 @@ public:
     SelfPlay(RawNetAgent* rawAgent, MCTSAgent* mctsAgent,  SearchLimits* searchLimits, PlaySettings* playSettings, RLSettings* rlSettings);
     ~SelfPlay();
 
+    /**
+     * @brief set_opening_pool Sets a filled opening pool from which the starting positions of the games are sampled
+     * @param openingPool Opening pool which is owned by the caller
+     */
+    void set_opening_pool(OpeningPool* openingPool);
+
     /**
      * @brief go Starts the self play game generation for a given number of games
      * @param numberOfGames Number of games to generate
      */
     void go(size_t numberOfGames, StatesManager* states);
 
+    /**
+     * @brief go_parallel Generates games concurrently, every worker plays its games on its own thread with its own search tree.
+     * The inference requests of all workers are pooled by the dispatcher, so the network is used with large batches.
+     * @param numberOfGames Number of games to generate (0 generates games until the export file is full)
+     * @param workers Workers for the concurrent games, their agents must use DispatchedNeuralNetAPI clients of the dispatcher
+     * @param dispatcher Dispatcher which runs the shared network
+     */
+    void go_parallel(size_t numberOfGames, const vector<SelfPlayWorker*>& workers, BatchDispatcher* dispatcher);
+
     /**
      * @brief go_arena Starts comparision matches between the original mctsAgent with the old NN weights and
      * the mctsContender which uses the new updated wieghts
      * @param mctsContender MCTSAgent using different NN weights
-     * @param numberOfGames Number of games to compare
+     * @param numberOfGames Maximum number of games to compare, the arena stops earlier if the SPRT is enabled and has reached a decision
      * @return Score in respect to the contender, as floating point number.
      *  Wins give 1.0 points, 0.5 for draw, 0.0 for loss.
      */
     TournamentResult go_arena(MCTSAgent *mctsContender, size_t numberOfGames, StatesManager* states);
+
+    /**
+     * @brief go_arena_parallel Plays the arena games concurrently. The producer and contender agents of all workers
+     * share one network per weights which are run by the given dispatchers.
+     * If the SPRT is enabled, no new games are started after it has reached a decision.
+     * @param numberOfGames Maximum number of games
+     * @param workers Workers for the concurrent games
+     * @param producerDispatcher Dispatcher of the producer network
+     * @param contenderDispatcher Dispatcher of the contender network
+     * @return Tournament result in respect to the contender
+     */
+    TournamentResult go_arena_parallel(size_t numberOfGames, const vector<ArenaWorker*>& workers,
+                                       BatchDispatcher* producerDispatcher, BatchDispatcher* contenderDispatcher);
 };
 #endif
 
@@ -160,6 +271,12 @@ public:
  */
 void clean_up(GamePGN& gamePGN, MCTSAgent* mctsAgent, StatesManager* states, Board* position);
 
+/**
+ * @brief init_selfplay_pgn Sets the header fields of a PGN struct which are shared by all self play and arena games
+ * @param gamePGN gamePGN struct
+ */
+void init_selfplay_pgn(GamePGN& gamePGN);
+
 /**
  * @brief init_board Initialies a new board with the starting position of the variant
  * @param variant Variant to be played
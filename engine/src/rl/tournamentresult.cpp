@@ -25,6 +25,8 @@
 
 #include "tournamentresult.h"
 #include <iomanip>
+#include <cmath>
+#include <algorithm>
 
 TournamentResult::TournamentResult() :
     numberWins(0),
@@ -44,11 +46,76 @@ float TournamentResult::score() const
     return (numberWins + numberDraws * 0.5f)/ numberGames();
 }
 
+float TournamentResult::elo() const
+{
+    if (numberGames() == 0) {
+        return 0;
+    }
+    // a single game result mustn't lead to an infinite elo difference
+    const float eps = 0.5f / numberGames();
+    return score_to_elo(std::min(std::max(score(), eps), 1.0f - eps));
+}
+
+float TournamentResult::elo_error() const
+{
+    const size_t games = numberGames();
+    if (games == 0) {
+        return 0;
+    }
+    const float curScore = score();
+    const float variance = (numberWins * pow(1.0f - curScore, 2) + numberDraws * pow(0.5f - curScore, 2) +
+                            numberLosses * pow(curScore, 2)) / games;
+    // 1.96 standard errors for the 95% confidence interval
+    const float scoreError = 1.96f * sqrt(variance / games);
+    const float eps = 0.5f / games;
+    const float scoreLow = std::min(std::max(curScore - scoreError, eps), 1.0f - eps);
+    const float scoreHigh = std::min(std::max(curScore + scoreError, eps), 1.0f - eps);
+    return (score_to_elo(scoreHigh) - score_to_elo(scoreLow)) / 2;
+}
+
+float TournamentResult::log_likelihood_ratio(float elo0, float elo1) const
+{
+    // every count is regularized like in fishtest, so the variance is positive even if only one result occurred
+    const float wins = max(float(numberWins), 1e-3f);
+    const float draws = max(float(numberDraws), 1e-3f);
+    const float losses = max(float(numberLosses), 1e-3f);
+    const float games = wins + draws + losses;
+    const float curScore = (wins + 0.5f * draws) / games;
+    const float variance = (wins * pow(1.0f - curScore, 2) + draws * pow(0.5f - curScore, 2) +
+                            losses * pow(curScore, 2)) / games;
+    const float score0 = elo_to_score(elo0);
+    const float score1 = elo_to_score(elo1);
+    return (score1 - score0) * (2 * curScore - score0 - score1) * games / (2 * variance);
+}
+
+SPRTDecision TournamentResult::sprt(float elo0, float elo1, float alpha, float beta) const
+{
+    const float llr = log_likelihood_ratio(elo0, elo1);
+    if (llr >= log((1 - beta) / alpha)) {
+        return SPRT_ACCEPT_H1;
+    }
+    if (llr <= log(beta / (1 - alpha))) {
+        return SPRT_ACCEPT_H0;
+    }
+    return SPRT_CONTINUE;
+}
+
+float elo_to_score(float elo)
+{
+    return 1.0f / (1.0f + pow(10.0f, -elo / 400.0f));
+}
+
+float score_to_elo(float score)
+{
+    return -400.0f * log10(1.0f / score - 1.0f);
+}
+
 std::ostream &operator<<(std::ostream &os, const TournamentResult &result)
 {
     os << result.playerA << "-" << result.playerB << ": " << result.numberWins
        << " - " << result.numberDraws << " - " << result.numberLosses << " [" <<
-          std::setprecision(2) << result.score() << "]";
+          std::setprecision(2) << result.score() << "]" << std::fixed << std::setprecision(1) <<
+          " Elo: " << result.elo() << " +/- " << result.elo_error() << std::defaultfloat;
     return os;
 }
 
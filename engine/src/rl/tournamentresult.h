@@ -37,6 +37,15 @@
 
 using namespace std;
 
+// decision of a sequential probability ratio test (SPRT)
+enum SPRTDecision {
+    SPRT_CONTINUE,
+    // the contender isn't stronger by elo1 (H0: elo <= elo0 is accepted)
+    SPRT_ACCEPT_H0,
+    // the contender is stronger (H1: elo >= elo1 is accepted)
+    SPRT_ACCEPT_H1
+};
+
 struct TournamentResult {
 
     string playerA;
@@ -59,11 +68,57 @@ struct TournamentResult {
      * @return score value
      */
      float score() const;
+
+    /**
+     * @brief elo Computes the elo difference of the first player from the score
+     * @return Elo difference, the score is clipped to avoid infinite values for 0% or 100% score
+     */
+    float elo() const;
+
+    /**
+     * @brief elo_error Computes the half width of the 95% confidence interval of the elo difference based on the
+     * trinomial distribution of wins, draws and losses
+     * @return Elo error bar
+     */
+    float elo_error() const;
+
+    /**
+     * @brief log_likelihood_ratio Computes the log likelihood ratio of the hypotheses H1: elo = elo1 and H0: elo = elo0
+     * using the normal approximation of the generalized SPRT for trinomial results (as used by cutechess and fishtest)
+     * @param elo0 Elo difference of H0
+     * @param elo1 Elo difference of H1
+     * @return Log likelihood ratio
+     */
+    float log_likelihood_ratio(float elo0, float elo1) const;
+
+    /**
+     * @brief sprt Runs the sequential probability ratio test on the current results
+     * @param elo0 Elo difference of H0
+     * @param elo1 Elo difference of H1
+     * @param alpha Probability of a false positive (accepting H1 although H0 is true)
+     * @param beta Probability of a false negative (accepting H0 although H1 is true)
+     * @return SPRT_CONTINUE if more games are needed, else the accepted hypothesis
+     */
+    SPRTDecision sprt(float elo0, float elo1, float alpha, float beta) const;
 };
 
+/**
+ * @brief elo_to_score Converts an elo difference into the expected score of the logistic elo model
+ * @param elo Elo difference
+ * @return Expected score in (0, 1)
+ */
+float elo_to_score(float elo);
+
+/**
+ * @brief score_to_elo Converts an expected score into the elo difference of the logistic elo model
+ * @param score Score in (0, 1)
+ * @return Elo difference
+ */
+float score_to_elo(float score);
+
 /**
  * @brief operator << Returns ostream for trounament result summary in the form
- *  "<PLAYER_A>-<PLAYER_B>: <NUMBER_WINS> - <NUMBER_DRAWS> - <NUMBER_LOSSES> [<SCORE>]"
+ *  "<PLAYER_A>-<PLAYER_B>: <NUMBER_WINS> - <NUMBER_DRAWS> - <NUMBER_LOSSES> [<SCORE>] Elo: <ELO> +/- <ELO_ERROR>"
  * @param os ostream
  * @param result Tournament result to print
  * @return osream
@@ -26,94 +26,457 @@
 #ifdef USE_RL
 #include "traindataexporter.h"
 #include <inttypes.h>
+#include <memory>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cstdio>
+#include <algorithm>
+#include <experimental/filesystem>
 #include "../util/communication.h"
 
+namespace fs = std::experimental::filesystem;
+
+namespace {
+// CRC-32 (zlib polynomial) which is used as the checksum of a sealed shard
+uint32_t crc32_update(uint32_t crc, const char* data, size_t size)
+{
+    static uint32_t table[256];
+    static bool tableInitialized = false;
+    if (!tableInitialized) {
+        for (uint32_t idx = 0; idx < 256; ++idx) {
+            uint32_t value = idx;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? 0xEDB88320U ^ (value >> 1) : value >> 1;
+            }
+            table[idx] = value;
+        }
+        tableInitialized = true;
+    }
+    crc = ~crc;
+    for (size_t idx = 0; idx < size; ++idx) {
+        crc = table[(crc ^ uint8_t(data[idx])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// hashes the relative path and the content of every file of a directory in lexicographical order of the paths
+string directory_checksum(const string& directory)
+{
+    vector<string> files;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(directory)) {
+        if (fs::is_regular_file(entry.path())) {
+            files.push_back(entry.path().string().substr(directory.size() + 1));
+        }
+    }
+    sort(files.begin(), files.end());
+
+    uint32_t crc = 0;
+    vector<char> content;
+    for (const string& file : files) {
+        crc = crc32_update(crc, file.c_str(), file.size() + 1);
+        ifstream stream(directory + "/" + file, ios::binary);
+        content.assign(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+        crc = crc32_update(crc, content.data(), content.size());
+    }
+    stringstream ss;
+    ss << hex << setw(8) << setfill('0') << crc;
+    return ss.str();
+}
+}  // namespace
+
+TrainGameBuffer::TrainGameBuffer(size_t capacity):
+    numberSamples(0)
+{
+    x.reserve(capacity * NB_VALUES_TOTAL);
+    value.reserve(capacity);
+    policy.reserve(capacity * NB_LABELS);
+    bestMoveQ.reserve(capacity);
+    sampleWeight.reserve(capacity);
+}
+
+void TrainGameBuffer::clear()
+{
+    x.clear();
+    xMasks.clear();
+    value.clear();
+    policy.clear();
+    policyIndices.clear();
+    policyEnds.clear();
+    bestMoveQ.clear();
+    sampleWeight.clear();
+    numberSamples = 0;
+}
+
 void TrainDataExporter::save_sample(const Board *pos, const EvalInfo& eval)
 {
-    if (startIdx+curSampleIdx >= numberSamples) {
+    if (startIdx+gameBuffer.numberSamples >= numberSamples) {
         info_string("Extended number of maximum samples");
         return;
     }
-    save_planes(pos);
-    save_policy(eval.legalMoves, eval.policyProbSmall, pos->side_to_move());
-    save_best_move_q(eval);
-    save_side_to_move(pos->side_to_move());
-    ++curSampleIdx;
+    save_sample(gameBuffer, pos, eval);
+}
+
+void TrainDataExporter::save_sample(TrainGameBuffer& buffer, const Board *pos, const EvalInfo& eval, float sampleWeight) const
+{
+    save_planes(buffer, pos);
+    save_policy(buffer, eval.legalMoves, eval.policyProbSmall, pos->side_to_move());
+    save_best_move_q(buffer, eval);
+    save_side_to_move(buffer, pos->side_to_move());
+    buffer.sampleWeight.push_back(sampleWeight);
     // value will be set later in export_game_result()
-    firstMove = false;
+    ++buffer.numberSamples;
 }
 
-void TrainDataExporter::save_best_move_q(const EvalInfo &eval)
+void TrainDataExporter::save_best_move_q(TrainGameBuffer& buffer, const EvalInfo &eval) const
 {
     // Q value of "best" move (a.k.a selected move after mcts search)
-    xt::xarray<float> qArray({ 1 }, eval.bestMoveQ);
+    buffer.bestMoveQ.push_back(eval.bestMoveQ);
+}
+
+void TrainDataExporter::save_side_to_move(TrainGameBuffer& buffer, Color col) const
+{
+    // in the case of WHITE a +1 is saved else -1 for BLACK
+    buffer.value.push_back(int16_t(-(col * 2 - 1)));
+}
 
-    if (firstMove) {
-        gameBestMoveQ = qArray;
+void TrainDataExporter::export_game_samples(Result result)
+{
+    export_game_samples(gameBuffer, result);
+}
+
+void TrainDataExporter::export_game_samples(TrainGameBuffer& buffer, Result result)
+{
+    lock_guard<mutex> lock(mtx);
+    if (rotateShards && startIdx != 0 && startIdx + buffer.numberSamples > numberSamples) {
+        // games aren't split between shards, the game starts the next shard instead
+        rotate_shard();
     }
-    else {
-        // concatenate the sample to array for the current game
-        gameBestMoveQ = xt::concatenate(xtuple(gameBestMoveQ, qArray));
+    if (startIdx >= numberSamples || buffer.numberSamples == 0) {
+        info_string("Extended number of maximum samples");
+        return;
+    }
+    // only the first samples of the game are kept if the game doesn't fit completely into the data set
+    const size_t exportedSamples = min(buffer.numberSamples, numberSamples - startIdx);
+
+    // the game is committed by the I/O thread after all of its samples have been written
+    ExportedGame game;
+    game.endIdx = startIdx + exportedSamples;
+    {
+        lock_guard<mutex> ioLock(ioMtx);
+        pendingGames.push_back(game);
     }
+
+    // game value update
+    apply_result_to_value(buffer, result);
+    stage_samples(buffer, 0, exportedSamples);
+
+    startIdx += exportedSamples;
+    gameIdx++;
 }
 
-void TrainDataExporter::save_side_to_move(Color col)
+void TrainDataExporter::stage_samples(const TrainGameBuffer& buffer, size_t firstSample, size_t numberStagedSamples)
 {
-    // in the case of WHITE a +1 is saved else -1 for BLACK
-    xt::xarray<int16_t> valueArray({ 1 }, -(col * 2 - 1));
+    while (numberStagedSamples != 0) {
+        // the staging buffer ends at the next chunk boundary of the data set
+        const size_t stagingCapacity = chunkSize - stagingStartIdx % chunkSize;
+        const size_t copiedSamples = min(numberStagedSamples, stagingCapacity - stagingBuffer.numberSamples);
+        const size_t lastSample = firstSample + copiedSamples;
+        const size_t planeValues = packPlanes ? NB_CHANNELS_TOTAL : NB_VALUES_TOTAL;
+        stagingBuffer.x.insert(stagingBuffer.x.end(), buffer.x.begin() + firstSample * planeValues, buffer.x.begin() + lastSample * planeValues);
+        if (packPlanes) {
+            stagingBuffer.xMasks.insert(stagingBuffer.xMasks.end(), buffer.xMasks.begin() + firstSample * NB_CHANNELS_TOTAL, buffer.xMasks.begin() + lastSample * NB_CHANNELS_TOTAL);
+        }
+        stagingBuffer.value.insert(stagingBuffer.value.end(), buffer.value.begin() + firstSample, buffer.value.begin() + lastSample);
+        if (sparsePolicy) {
+            const size_t policyBegin = firstSample == 0 ? 0 : buffer.policyEnds[firstSample-1];
+            const size_t policyEnd = buffer.policyEnds[lastSample-1];
+            const size_t stagingPolicyBegin = stagingBuffer.policy.size();
+            stagingBuffer.policy.insert(stagingBuffer.policy.end(), buffer.policy.begin() + policyBegin, buffer.policy.begin() + policyEnd);
+            stagingBuffer.policyIndices.insert(stagingBuffer.policyIndices.end(), buffer.policyIndices.begin() + policyBegin, buffer.policyIndices.begin() + policyEnd);
+            for (size_t idx = firstSample; idx < lastSample; ++idx) {
+                stagingBuffer.policyEnds.push_back(stagingPolicyBegin + buffer.policyEnds[idx] - policyBegin);
+            }
+        }
+        else {
+            stagingBuffer.policy.insert(stagingBuffer.policy.end(), buffer.policy.begin() + firstSample * NB_LABELS, buffer.policy.begin() + lastSample * NB_LABELS);
+        }
+        stagingBuffer.bestMoveQ.insert(stagingBuffer.bestMoveQ.end(), buffer.bestMoveQ.begin() + firstSample, buffer.bestMoveQ.begin() + lastSample);
+        stagingBuffer.sampleWeight.insert(stagingBuffer.sampleWeight.end(), buffer.sampleWeight.begin() + firstSample, buffer.sampleWeight.begin() + lastSample);
+        stagingBuffer.numberSamples += copiedSamples;
+        firstSample = lastSample;
+        numberStagedSamples -= copiedSamples;
+
+        if (stagingBuffer.numberSamples == stagingCapacity) {
+            write_staging_buffer();
+        }
+    }
+}
 
-    if (firstMove) {
-        gameValue = valueArray;
+void TrainDataExporter::write_staging_buffer()
+{
+    if (stagingBuffer.numberSamples == 0) {
+        return;
+    }
+    // the chunk is handed over to the I/O thread and the export continues with an empty staging buffer
+    shared_ptr<TrainGameBuffer> chunk = make_shared<TrainGameBuffer>(chunkSize);
+    swap(*chunk, stagingBuffer);
+    const size_t offsetIdx = stagingStartIdx;
+    const size_t policyOffsetIdx = get_policy_offset_idx(offsetIdx);
+    ioPool->enqueue([this, chunk, offsetIdx, policyOffsetIdx]() {
+        write_samples(*chunk, offsetIdx, policyOffsetIdx);
+    });
+    stagingStartIdx += chunk->numberSamples;
+}
+
+void TrainDataExporter::start_new_chunk()
+{
+    if (stagingStartIdx % chunkSize == 0) {
+        return;
+    }
+    // the written part of the chunk may already be committed, the padding is never written
+    // and only marks its range as done, so the following games can be committed
+    const size_t paddingEndIdx = stagingStartIdx - stagingStartIdx % chunkSize + chunkSize;
+    commit_samples(stagingStartIdx, paddingEndIdx);
+    stagingStartIdx = paddingEndIdx;
+    startIdx = paddingEndIdx;
+}
+
+size_t TrainDataExporter::get_policy_offset_idx(size_t sampleIdx) const
+{
+    return sampleIdx / chunkSize * chunkSize * MAX_NB_LEGAL_MOVES;
+}
+
+void TrainDataExporter::write_samples(const TrainGameBuffer& buffer, size_t offsetIdx, size_t policyOffsetIdx)
+{
+    const size_t nbSamples = buffer.numberSamples;
+    xt::xarray<int16_t> value(vector<size_t>{nbSamples});
+    xt::xarray<float> bestMoveQ(vector<size_t>{nbSamples});
+    xt::xarray<float> sampleWeight(vector<size_t>{nbSamples});
+    copy(buffer.value.begin(), buffer.value.end(), value.data());
+    copy(buffer.bestMoveQ.begin(), buffer.bestMoveQ.end(), bestMoveQ.data());
+    copy(buffer.sampleWeight.begin(), buffer.sampleWeight.end(), sampleWeight.data());
+
+    // write value to roi
+    z5::types::ShapeType offset = { offsetIdx };
+    if (packPlanes) {
+        xt::xarray<uint64_t> xMasks(vector<size_t>{nbSamples, NB_CHANNELS_TOTAL});
+        xt::xarray<int16_t> xOffsets(vector<size_t>{nbSamples, NB_CHANNELS_TOTAL});
+        copy(buffer.xMasks.begin(), buffer.xMasks.end(), xMasks.data());
+        copy(buffer.x.begin(), buffer.x.end(), xOffsets.data());
+        z5::types::ShapeType offsetPlanes = { offsetIdx, 0 };
+        z5::multiarray::writeSubarray<uint64_t>(dxMasks, xMasks, offsetPlanes.begin());
+        z5::multiarray::writeSubarray<int16_t>(dxOffsets, xOffsets, offsetPlanes.begin());
+    }
+    else {
+        xt::xarray<int16_t> x(vector<size_t>{nbSamples, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH});
+        copy(buffer.x.begin(), buffer.x.end(), x.data());
+        z5::types::ShapeType offsetPlanes = { offsetIdx, 0, 0, 0 };
+        z5::multiarray::writeSubarray<int16_t>(dx, x, offsetPlanes.begin());
+    }
+    z5::multiarray::writeSubarray<int16_t>(dValue, value, offset.begin());
+    z5::multiarray::writeSubarray<float>(dbestMoveQ, bestMoveQ, offset.begin());
+    if (dSampleWeight != nullptr) {
+        z5::multiarray::writeSubarray<float>(dSampleWeight, sampleWeight, offset.begin());
+    }
+    // the policy is written last, the samples are committed afterwards
+
+    if (sparsePolicy) {
+        const size_t nbEntries = buffer.policy.size();
+        xt::xarray<int64_t> policyBegins(vector<size_t>{nbSamples});
+        xt::xarray<int64_t> policyEnds(vector<size_t>{nbSamples});
+        for (size_t idx = 0; idx < nbSamples; ++idx) {
+            policyBegins[idx] = int64_t(policyOffsetIdx + (idx == 0 ? 0 : buffer.policyEnds[idx-1]));
+            policyEnds[idx] = int64_t(policyOffsetIdx + buffer.policyEnds[idx]);
+        }
+        z5::multiarray::writeSubarray<int64_t>(dPolicyBegins, policyBegins, offset.begin());
+        z5::multiarray::writeSubarray<int64_t>(dPolicyEnds, policyEnds, offset.begin());
+        if (nbEntries != 0) {
+            xt::xarray<int16_t> policyIndices(vector<size_t>{nbEntries});
+            xt::xarray<float> policyProbs(vector<size_t>{nbEntries});
+            copy(buffer.policyIndices.begin(), buffer.policyIndices.end(), policyIndices.data());
+            copy(buffer.policy.begin(), buffer.policy.end(), policyProbs.data());
+            z5::types::ShapeType offsetEntries = { policyOffsetIdx };
+            z5::multiarray::writeSubarray<int16_t>(dPolicyIndices, policyIndices, offsetEntries.begin());
+            z5::multiarray::writeSubarray<float>(dPolicyProbs, policyProbs, offsetEntries.begin());
+        }
     }
     else {
-        // concatenate the sample to array for the current game
-        gameValue = xt::concatenate(xtuple(gameValue, valueArray));
+        xt::xarray<float> policy(vector<size_t>{nbSamples, NB_LABELS});
+        copy(buffer.policy.begin(), buffer.policy.end(), policy.data());
+        z5::types::ShapeType offsetPolicy = { offsetIdx, 0 };
+        z5::multiarray::writeSubarray<float>(dPolicy, policy, offsetPolicy.begin());
     }
+    commit_samples(offsetIdx, offsetIdx + nbSamples);
 }
 
-void TrainDataExporter::export_game_samples(Result result)
+void TrainDataExporter::commit_samples(size_t beginIdx, size_t endIdx)
 {
-    if (startIdx >= numberSamples) {
-        info_string("Extended number of maximum samples");
+    lock_guard<mutex> lock(ioMtx);
+    writtenRanges[beginIdx] = endIdx;
+    // chunks can be written in any order, only the written prefix of the data set can be committed
+    auto it = writtenRanges.find(writtenIdx);
+    while (it != writtenRanges.end()) {
+        writtenIdx = it->second;
+        writtenRanges.erase(it);
+        it = writtenRanges.find(writtenIdx);
+    }
+
+    if (pendingGames.empty() || pendingGames.front().endIdx > writtenIdx) {
         return;
     }
+    ExportedGame lastGame;
+    while (!pendingGames.empty() && pendingGames.front().endIdx <= writtenIdx) {
+        lastGame = pendingGames.front();
+        pendingGames.pop_front();
+        ++committedGames;
+        save_start_idx(committedGames, lastGame.endIdx);
+    }
 
-    // game value update
-    apply_result_to_value(result);
+    // the attributes are written after the start indices and mark the committed games as valid
+    nlohmann::json attributes;
+    attributes["committed_games"] = committedGames;
+    attributes["committed_samples"] = lastGame.endIdx;
+    write_commit_attributes(attributes);
+}
 
-    // write value to roi
-    z5::types::ShapeType offset = { startIdx };
-    z5::types::ShapeType offsetPlanes = { startIdx, 0, 0, 0 };
-    z5::multiarray::writeSubarray<int16_t>(dx, gameX, offsetPlanes.begin());
-    z5::multiarray::writeSubarray<int16_t>(dValue, gameValue, offset.begin());
-    z5::multiarray::writeSubarray<float>(dbestMoveQ, gameBestMoveQ, offset.begin());
-    z5::types::ShapeType offsetPolicy = { startIdx, 0 };
-    z5::multiarray::writeSubarray<float>(dPolicy, gamePolicy, offsetPolicy.begin());
-
-    startIdx += curSampleIdx;
-    gameIdx++;
-    save_start_idx();
+void TrainDataExporter::write_commit_attributes(const nlohmann::json& attributes)
+{
+    nlohmann::json fileAttributes;
+    z5::readAttributes(file, fileAttributes);
+    fileAttributes.update(attributes);
+    const string attributesFileName = (fs::path(file.path()) / ".zattrs").string();
+    ofstream attributesFile(attributesFileName + ".tmp");
+    attributesFile << fileAttributes.dump(4) << endl;
+    attributesFile.close();
+    rename((attributesFileName + ".tmp").c_str(), attributesFileName.c_str());
 }
 
-TrainDataExporter::TrainDataExporter(const string& fileName, size_t numberChunks, size_t chunkSize):
+TrainDataExporter::TrainDataExporter(const string& fileName, size_t numberChunks, size_t chunkSize, bool sparsePolicy, bool packPlanes,
+                                     bool rotateShards, const string& modelName, bool resume):
+    fileNameBase(fileName.substr(0, fileName.rfind(".zarr"))),
+    rotateShards(rotateShards),
+    resume(resume),
+    modelName(modelName),
+    shardIdx(0),
+    file(fileName),
     numberChunks(numberChunks),
     chunkSize(chunkSize),
     numberSamples(numberChunks * chunkSize),
-    firstMove(true),
+    sparsePolicy(sparsePolicy),
+    packPlanes(packPlanes),
+    stagingBuffer(chunkSize),
+    stagingStartIdx(0),
+    ioPool(new WorkerPool(1)),
+    writtenIdx(0),
+    committedGames(0),
     gameIdx(0),
-    startIdx(0),
-    curSampleIdx(0)
+    startIdx(0)
 {
-    // get handle to a File on the filesystem
-    z5::filesystem::handle::File file(fileName);
+    if (rotateShards) {
+        // sealed shards are skipped, an unsealed shard is resumed or overwritten
+        while (ifstream(get_shard_file_name(shardIdx, ".json")).good()) {
+            ++shardIdx;
+        }
+        file = z5::filesystem::handle::File(get_shard_file_name(shardIdx, ".zarr"));
+    }
+    open_export_file();
+}
 
+void TrainDataExporter::open_export_file()
+{
     if (file.exists()) {
-        cout << "Warning: Export file already exists. It will be overwritten" << endl;
-        open_dataset_from_file(file);
+        if (resume && resume_export()) {
+            return;
+        }
+        // the previous samples are removed, so they can't be exported again together with the new ones
+        cout << "Warning: Export file " << fs::path(file.path()).string() << " already exists. It will be overwritten" << endl;
+        fs::remove_all(fs::path(file.path()));
     }
-    else {
-        create_new_dataset_file(file);
+    create_new_dataset_file();
+}
+
+string TrainDataExporter::get_shard_file_name(size_t idx, const string& extension) const
+{
+    return fileNameBase + "_" + to_string(idx) + extension;
+}
+
+void TrainDataExporter::seal_shard()
+{
+    write_staging_buffer();
+    ioPool->wait_all();
+
+    // the manifest is written to a temporary file first, so it only becomes visible once it is complete
+    nlohmann::json manifest;
+    manifest["file"] = fs::path(file.path()).filename().string();
+    manifest["games"] = committedGames;
+    manifest["samples"] = startIdx;
+    manifest["model"] = modelName;
+    manifest["sparse_policy"] = sparsePolicy;
+    manifest["pack_planes"] = packPlanes;
+    manifest["checksum_type"] = "crc32";
+    manifest["checksum"] = directory_checksum(fs::path(file.path()).string());
+    const string manifestFileName = get_shard_file_name(shardIdx, ".json");
+    ofstream manifestFile(manifestFileName + ".tmp");
+    manifestFile << manifest.dump(4) << endl;
+    manifestFile.close();
+    rename((manifestFileName + ".tmp").c_str(), manifestFileName.c_str());
+    cout << "Sealed shard " << manifestFileName << " with " << committedGames << " games and " << startIdx << " samples" << endl;
+}
+
+void TrainDataExporter::rotate_shard()
+{
+    seal_shard();
+
+    writtenRanges.clear();
+    pendingGames.clear();
+    writtenIdx = 0;
+    committedGames = 0;
+    gameIdx = 0;
+    startIdx = 0;
+    stagingStartIdx = 0;
+    ++shardIdx;
+    file = z5::filesystem::handle::File(get_shard_file_name(shardIdx, ".zarr"));
+    open_export_file();
+}
+
+bool TrainDataExporter::resume_export()
+{
+    nlohmann::json attributes;
+    z5::readAttributes(file, attributes);
+    if (attributes.find("committed_games") == attributes.end()) {
+        cout << "Export file doesn't contain any committed games and can't be resumed" << endl;
+        return false;
+    }
+    if (sparsePolicy && !z5::filesystem::handle::Dataset(file, "y_policy_begins").exists()) {
+        cout << "Export file uses an older sparse policy layout and can't be resumed" << endl;
+        return false;
+    }
+    open_dataset_from_file();
+    gameIdx = attributes["committed_games"].get<size_t>();
+    startIdx = attributes["committed_samples"].get<size_t>();
+    committedGames = gameIdx;
+    writtenIdx = startIdx;
+    stagingStartIdx = startIdx;
+    cout << "Resuming export after " << gameIdx << " games and " << startIdx << " samples" << endl;
+    start_new_chunk();
+    return true;
+}
+
+TrainDataExporter::~TrainDataExporter()
+{
+    flush();
+    delete ioPool;
+}
+
+void TrainDataExporter::flush()
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        write_staging_buffer();
+        start_new_chunk();
     }
+    ioPool->wait_all();
 }
 
 size_t TrainDataExporter::get_number_samples() const
@@ -123,82 +486,125 @@ size_t TrainDataExporter::get_number_samples() const
 
 bool TrainDataExporter::is_file_full()
 {
+    lock_guard<mutex> lock(mtx);
+    // the export continues in the next shard
+    if (rotateShards) {
+        return false;
+    }
     return startIdx >= numberSamples;
 }
 
 void TrainDataExporter::new_game()
 {
-    firstMove = true;
-    curSampleIdx = 0;
+    gameBuffer.clear();
 }
 
-void TrainDataExporter::save_planes(const Board *pos)
+void TrainDataExporter::save_planes(TrainGameBuffer& buffer, const Board *pos) const
 {
     // x / plane representation
     float inputPlanes[NB_VALUES_TOTAL];
     board_to_planes(pos, pos->number_repetitions(), false, inputPlanes);
-    // write array to roi
-    xt::xarray<int16_t>::shape_type planesShape = { 1, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH };
-    xt::xarray<int16_t> planes(planesShape);
-    for (size_t idx = 0; idx < NB_VALUES_TOTAL; ++idx) {
-        planes.data()[idx] = int16_t(inputPlanes[idx]);
-    }
 
-    if (firstMove) {
-        gameX = planes;
+    if (packPlanes) {
+        // every plane is either a bitboard or filled with a constant value: value = offset + bit
+        for (size_t channel = 0; channel < NB_CHANNELS_TOTAL; ++channel) {
+            const float* plane = inputPlanes + channel * NB_SQUARES;
+            const float planeOffset = *min_element(plane, plane + NB_SQUARES);
+            uint64_t mask = 0;
+            for (size_t sq = 0; sq < NB_SQUARES; ++sq) {
+                assert(plane[sq] == planeOffset || plane[sq] == planeOffset + 1);
+                if (plane[sq] != planeOffset) {
+                    mask |= uint64_t(1) << sq;
+                }
+            }
+            buffer.xMasks.push_back(mask);
+            buffer.x.push_back(int16_t(planeOffset));
+        }
+        return;
     }
-    else {
-        // concatenate the sample to array for the current game
-        gameX = xt::concatenate(xtuple(gameX, planes));
+
+    // append the planes to the preallocated game buffer
+    const size_t offset = buffer.x.size();
+    buffer.x.resize(offset + NB_VALUES_TOTAL);
+    for (size_t idx = 0; idx < NB_VALUES_TOTAL; ++idx) {
+        buffer.x[offset + idx] = int16_t(inputPlanes[idx]);
     }
 }
 
-void TrainDataExporter::save_policy(const vector<Move>& legalMoves, const DynamicVector<float>& policyProbSmall, Color sideToMove)
+void TrainDataExporter::save_policy(TrainGameBuffer& buffer, const vector<Move>& legalMoves, const DynamicVector<float>& policyProbSmall, Color sideToMove) const
 {
     assert(legalMoves.size() == policyProbSmall.size());
 
-    xt::xarray<float>::shape_type shapePolicy = { 1, NB_LABELS };
-    xt::xarray<float> policy(shapePolicy, 0);
-
-    for (size_t idx = 0; idx < legalMoves.size(); ++idx) {
-        size_t policyIdx;
-        if (sideToMove == WHITE) {
-            policyIdx = MV_LOOKUP_CLASSIC[legalMoves[idx]];
-        }
-        else {
-            policyIdx = MV_LOOKUP_MIRRORED_CLASSIC[legalMoves[idx]];
+    if (sparsePolicy) {
+        // only the moves with a non-zero probability are stored
+        for (size_t idx = 0; idx < legalMoves.size(); ++idx) {
+            if (policyProbSmall[idx] != 0) {
+                buffer.policyIndices.push_back(int16_t(get_policy_index(legalMoves[idx], sideToMove)));
+                buffer.policy.push_back(policyProbSmall[idx]);
+            }
         }
-        policy[policyIdx] = policyProbSmall[idx];
+        buffer.policyEnds.push_back(buffer.policy.size());
+        return;
     }
 
-    if (firstMove) {
-        gamePolicy = policy;
+    // the new policy row is initialized with zeros
+    const size_t offset = buffer.policy.size();
+    buffer.policy.resize(offset + NB_LABELS, 0.0f);
+
+    for (size_t idx = 0; idx < legalMoves.size(); ++idx) {
+        buffer.policy[offset + get_policy_index(legalMoves[idx], sideToMove)] = policyProbSmall[idx];
     }
-    else {
-        // concatenate the sample to array for the current game
-        gamePolicy = xt::concatenate(xtuple(gamePolicy, policy));
+}
+
+size_t TrainDataExporter::get_policy_index(Move move, Color sideToMove)
+{
+    if (sideToMove == WHITE) {
+        return MV_LOOKUP_CLASSIC[move];
     }
+    return MV_LOOKUP_MIRRORED_CLASSIC[move];
 }
 
-void TrainDataExporter::save_start_idx()
+void TrainDataExporter::save_start_idx(size_t idx, size_t sampleIdx)
 {
     // gameStartIdx
     // write value to roi
-    z5::types::ShapeType offsetStartIdx = { gameIdx };
-    xt::xarray<int32_t> arrayGameStartIdx({ 1 }, int32_t(startIdx));
+    z5::types::ShapeType offsetStartIdx = { idx };
+    xt::xarray<int32_t> arrayGameStartIdx({ 1 }, int32_t(sampleIdx));
     z5::multiarray::writeSubarray<int32_t>(dStartIndex, arrayGameStartIdx, offsetStartIdx.begin());
 }
 
-void TrainDataExporter::open_dataset_from_file(const z5::filesystem::handle::File& file)
+void TrainDataExporter::open_dataset_from_file()
 {
     dStartIndex = z5::openDataset(file, "start_indices");
-    dx = z5::openDataset(file, "x");
+    if (packPlanes) {
+        dxMasks = z5::openDataset(file, "x_masks");
+        dxOffsets = z5::openDataset(file, "x_offsets");
+    }
+    else {
+        dx = z5::openDataset(file, "x");
+    }
     dValue = z5::openDataset(file, "y_value");
-    dPolicy = z5::openDataset(file, "y_policy");
+    if (sparsePolicy) {
+        dPolicyIndices = z5::openDataset(file, "y_policy_indices");
+        dPolicyProbs = z5::openDataset(file, "y_policy_probs");
+        dPolicyBegins = z5::openDataset(file, "y_policy_begins");
+        dPolicyEnds = z5::openDataset(file, "y_policy_ends");
+    }
+    else {
+        dPolicy = z5::openDataset(file, "y_policy");
+    }
     dbestMoveQ = z5::openDataset(file, "y_best_move_q");
+    if (z5::filesystem::handle::Dataset(file, "y_sample_weight").exists()) {
+        dSampleWeight = z5::openDataset(file, "y_sample_weight");
+    }
+    else {
+        // files of older versions are continued without sample weights, the loader treats them as weight 1
+        cout << "Warning: Export file doesn't contain y_sample_weight. The sample weights won't be exported" << endl;
+        dSampleWeight.reset();
+    }
 }
 
-void TrainDataExporter::create_new_dataset_file(const z5::filesystem::handle::File &file)
+void TrainDataExporter::create_new_dataset_file()
 {
     // create the file in zarr format
     const bool createAsZarr = true;
@@ -207,23 +613,45 @@ void TrainDataExporter::create_new_dataset_file(const z5::filesystem::handle::Fi
     // create a new zarr dataset
     std::vector<size_t> shape = { numberSamples, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH };
     std::vector<size_t> chunks = { chunkSize, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH };
-    dStartIndex = z5::createDataset(file, "start_indices", "int32", { numberSamples }, { chunkSize });
-    dx = z5::createDataset(file, "x", "int16", shape, chunks);
+    // every start index is committed separately, so it is stored in its own chunk which is written only once
+    dStartIndex = z5::createDataset(file, "start_indices", "int32", { numberSamples }, { 1 });
+    if (packPlanes) {
+        dxMasks = z5::createDataset(file, "x_masks", "uint64", { numberSamples, NB_CHANNELS_TOTAL }, { chunkSize, NB_CHANNELS_TOTAL });
+        dxOffsets = z5::createDataset(file, "x_offsets", "int16", { numberSamples, NB_CHANNELS_TOTAL }, { chunkSize, NB_CHANNELS_TOTAL });
+    }
+    else {
+        dx = z5::createDataset(file, "x", "int16", shape, chunks);
+    }
     dValue = z5::createDataset(file, "y_value", "int16", { numberSamples }, { chunkSize });
-    dPolicy = z5::createDataset(file, "y_policy", "float32", { numberSamples, NB_LABELS }, { chunkSize, NB_LABELS });
+    if (sparsePolicy) {
+        // every sample chunk owns a region for the worst case of MAX_NB_LEGAL_MOVES entries per sample,
+        // so the entry chunks are never shared between sample chunks and chunks which are never written don't use disk space
+        const size_t maxNbEntries = numberSamples * MAX_NB_LEGAL_MOVES;
+        const size_t entriesChunkSize = chunkSize * SPARSE_POLICY_CHUNK_ENTRIES;
+        dPolicyIndices = z5::createDataset(file, "y_policy_indices", "int16", { maxNbEntries }, { entriesChunkSize });
+        dPolicyProbs = z5::createDataset(file, "y_policy_probs", "float32", { maxNbEntries }, { entriesChunkSize });
+        dPolicyBegins = z5::createDataset(file, "y_policy_begins", "int64", { numberSamples }, { chunkSize });
+        dPolicyEnds = z5::createDataset(file, "y_policy_ends", "int64", { numberSamples }, { chunkSize });
+    }
+    else {
+        dPolicy = z5::createDataset(file, "y_policy", "float32", { numberSamples, NB_LABELS }, { chunkSize, NB_LABELS });
+    }
     dbestMoveQ = z5::createDataset(file, "y_best_move_q", "float32", { numberSamples }, { chunkSize });
+    dSampleWeight = z5::createDataset(file, "y_sample_weight", "float32", { numberSamples }, { chunkSize });
 
-    save_start_idx();
+    save_start_idx(0, 0);
 }
 
-void TrainDataExporter::apply_result_to_value(Result result)
+void TrainDataExporter::apply_result_to_value(TrainGameBuffer& buffer, Result result) const
 {
     // value
     if (result == BLACK_WIN) {
-        gameValue *= -1;
+        for (int16_t& value : buffer.value) {
+            value = -value;
+        }
     }
     else if (result == DRAWN) {
-        gameValue *= 0;
+        fill(buffer.value.begin(), buffer.value.end(), int16_t(0));
     }
 }
 
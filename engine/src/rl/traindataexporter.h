@@ -22,7 +22,9 @@
  * Created on 12.09.2019
  * @author: queensgambit
  *
- * Exporter class which saves the board position in planes (x) and the target values (y) for NN training
+ * Exporter class which saves the board position in planes (x) and the target values (y) for NN training.
+ * The samples of a game are collected in a preallocated TrainGameBuffer. Finished games are staged into chunks
+ * which match the zarr chunks and every full chunk is compressed and written by a background I/O thread.
  */
 
 #ifndef TRAINDATAEXPORTER_H
@@ -30,6 +32,10 @@
 
 #ifdef USE_RL
 #include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
 
 #include "nlohmann/json.hpp"
 #include "xtensor/xarray.hpp"
@@ -46,92 +52,282 @@
 #include "../domain/crazyhouse/constants.h"
 #include "../node.h"
 #include "../evalinfo.h"
+#include "../util/workerpool.h"
+
+// number of samples for which memory is reserved in a game buffer, longer games reallocate the buffer once
+const size_t TRAIN_GAME_BUFFER_CAPACITY = 512;
+// average number of sparse policy entries per sample which is used for the chunk size of the sparse policy datasets
+const size_t SPARSE_POLICY_CHUNK_ENTRIES = 64;
+
+// training samples of a single game which are collected until the game result is known
+struct TrainGameBuffer
+{
+    // input planes of NB_VALUES_TOTAL per sample or the plane offsets of NB_CHANNELS_TOTAL per sample for the packed plane format
+    vector<int16_t> x;
+    // bitboard of each input plane (only used for the packed plane format)
+    vector<uint64_t> xMasks;
+    vector<int16_t> value;
+    // dense policy of NB_LABELS per sample or the probabilities of the legal moves for the sparse policy format
+    vector<float> policy;
+    // policy indices of the legal moves and the end position of each sample in policy (only used for the sparse policy format)
+    vector<int16_t> policyIndices;
+    vector<size_t> policyEnds;
+    vector<float> bestMoveQ;
+    vector<float> sampleWeight;
+    size_t numberSamples;
+
+    /**
+     * @brief TrainGameBuffer
+     * @param capacity Number of samples for which memory is reserved
+     */
+    TrainGameBuffer(size_t capacity=TRAIN_GAME_BUFFER_CAPACITY);
+
+    /**
+     * @brief clear Prepares the buffer for a new game, the reserved memory is kept
+     */
+    void clear();
+};
+
+// end position of an exported game in the data set which becomes persistent after all its samples have been written
+struct ExportedGame
+{
+    size_t endIdx;
+};
 
 class TrainDataExporter
 {
 private:
+    // export file name without the .zarr extension
+    string fileNameBase;
+    // a full file is sealed and the export continues in the next shard <fileNameBase>_<shardIdx>.zarr
+    bool rotateShards;
+    // continues an existing export file after its last committed game instead of overwriting it
+    bool resume;
+    // model name which is written to the manifest of a sealed shard
+    string modelName;
+    size_t shardIdx;
+    z5::filesystem::handle::File file;
     size_t numberChunks;
     size_t chunkSize;
     size_t numberSamples;
+    // stores the policy in compressed sparse row format instead of a dense NB_LABELS vector per sample
+    bool sparsePolicy;
+    // stores every input plane as a 64 bit mask and an offset instead of NB_SQUARES int16 values
+    bool packPlanes;
     std::unique_ptr<z5::Dataset> dStartIndex;
     std::unique_ptr<z5::Dataset> dx;
+    std::unique_ptr<z5::Dataset> dxMasks;
+    std::unique_ptr<z5::Dataset> dxOffsets;
     std::unique_ptr<z5::Dataset> dValue;
     std::unique_ptr<z5::Dataset> dPolicy;
     std::unique_ptr<z5::Dataset> dbestMoveQ;
+    // is empty if an existing file without sample weights is continued
+    std::unique_ptr<z5::Dataset> dSampleWeight;
+    std::unique_ptr<z5::Dataset> dPolicyIndices;
+    std::unique_ptr<z5::Dataset> dPolicyProbs;
+    std::unique_ptr<z5::Dataset> dPolicyBegins;
+    std::unique_ptr<z5::Dataset> dPolicyEnds;
 
-    xt::xarray<int16_t> gameX;
-    xt::xarray<int16_t> gameValue;
-    xt::xarray<float> gamePolicy;
-    xt::xarray<float> gameBestMoveQ;
-    bool firstMove;
+    // buffer of the game which is exported by the single game interface (new_game(), save_sample() and export_game_samples())
+    TrainGameBuffer gameBuffer;
+    // samples of finished games which haven't been written yet, they start at the sample index stagingStartIdx
+    TrainGameBuffer stagingBuffer;
+    size_t stagingStartIdx;
+    // protects the staging buffer and the indices when games are exported from several threads
+    std::mutex mtx;
+    // single background thread which compresses and writes the chunks to the data set
+    WorkerPool* ioPool;
+
+    // protects the commit state below which is updated by the I/O thread
+    std::mutex ioMtx;
+    // sample ranges [begin, end) which have been written but don't continue the written prefix yet
+    map<size_t, size_t> writtenRanges;
+    // all samples before this index have been written
+    size_t writtenIdx;
+    // exported games which haven't been committed yet
+    deque<ExportedGame> pendingGames;
+    // number of games whose samples and start index are persistent
+    size_t committedGames;
 
     // current number of games - 1
     size_t gameIdx;
     // current sample index to insert
     size_t startIdx;
-    size_t curSampleIdx;
 
     /**
      * @brief export_planes Exports the board in plane representation (x)
+     * @param buffer Buffer of the current game
      * @param pos Board position to export
      */
-    void save_planes(const Board *pos);
+    void save_planes(TrainGameBuffer& buffer, const Board *pos) const;
 
     /**
      * @brief save_policy Saves the policy (e.g. mctsPolicy) to the matrix
+     * @param buffer Buffer of the current game
      * @param legalMoves List of legal moves
      * @param policyProbSmall Probability for each move
      * @param sideToMove Current side to move
      */
-    void save_policy(const vector<Move>& legalMoves, const DynamicVector<float>& policyProbSmall, Color sideToMove);
+    void save_policy(TrainGameBuffer& buffer, const vector<Move>& legalMoves, const DynamicVector<float>& policyProbSmall, Color sideToMove) const;
+
+    /**
+     * @brief get_policy_index Returns the index of a move in the policy vector of the neural network
+     * @param move Legal move
+     * @param sideToMove Current side to move
+     * @return Policy index in [0, NB_LABELS)
+     */
+    static size_t get_policy_index(Move move, Color sideToMove);
 
     /**
      * @brief save_best_move_q Saves the Q-value of the move which was selected after MCTS search(Optional training sample feature)
+     * @param buffer Buffer of the current game
      * @param eval Filled EvalInfo struct after mcts search
      */
-    void save_best_move_q(const EvalInfo& eval);
+    void save_best_move_q(TrainGameBuffer& buffer, const EvalInfo& eval) const;
 
     /**
      * @brief save_side_to_move Saves the current side to move as a +1 for WHITE and -1 for BLACK.
      * The current side to move is either WHITE(0) or BLACK(1).
      * Later if WHITE won the game the value array is inverted.
      * For a draw it will be multiplied by 0.
+     * @param buffer Buffer of the current game
      * @param col current side to move
      */
-    void save_side_to_move(Color col);
+    void save_side_to_move(TrainGameBuffer& buffer, Color col) const;
+
+    /**
+     * @brief save_start_idx Saves the starting index of a game to the game array
+     * @param idx Game index
+     * @param sampleIdx Index of the first sample of the game
+     */
+    void save_start_idx(size_t idx, size_t sampleIdx);
+
+    /**
+     * @brief commit_samples Marks a written sample range and commits every game whose samples are now completely written.
+     * The start indices of the committed games are saved first and the commit attributes of the file afterwards,
+     * so an interrupted export never references samples which haven't been written (called by the I/O thread).
+     * @param beginIdx First written sample
+     * @param endIdx End of the written samples (exclusive)
+     */
+    void commit_samples(size_t beginIdx, size_t endIdx);
+
+    /**
+     * @brief open_export_file Resumes the current export file if enabled and possible, otherwise a new file replaces it
+     */
+    void open_export_file();
+
+    /**
+     * @brief get_shard_file_name Returns the file name of a shard
+     * @param idx Shard index
+     * @param extension File extension, ".zarr" for the data set and ".json" for the manifest
+     */
+    string get_shard_file_name(size_t idx, const string& extension) const;
+
+    /**
+     * @brief seal_shard Writes all samples of the current shard and its manifest <fileNameBase>_<shardIdx>.json
+     * with the number of games, the number of samples, the model name and a checksum of the shard files.
+     * A shard with a manifest is complete and won't be changed anymore. The mutex must be locked by the caller.
+     */
+    void seal_shard();
+
+    /**
+     * @brief rotate_shard Seals the current shard and continues the export in a new shard. The mutex must be locked by the caller.
+     */
+    void rotate_shard();
+
+    /**
+     * @brief resume_export Opens the data sets of an existing file and continues the export after the last committed game
+     * @return True, if the file contains commit attributes and the current data format
+     */
+    bool resume_export();
+
+    /**
+     * @brief stage_samples Appends samples of a finished game to the staging buffer and writes every completed chunk.
+     * The mutex must be locked by the caller.
+     * @param buffer Buffer of the finished game
+     * @param firstSample Index of the first sample of the buffer to stage
+     * @param numberStagedSamples Number of samples to stage
+     */
+    void stage_samples(const TrainGameBuffer& buffer, size_t firstSample, size_t numberStagedSamples);
+
+    /**
+     * @brief write_staging_buffer Hands the staging buffer over to the I/O thread and starts a new staging buffer.
+     * The mutex must be locked by the caller.
+     */
+    void write_staging_buffer();
+
+    /**
+     * @brief write_samples Writes the samples of a buffer to the data set starting at the given sample index (called by the I/O thread)
+     * @param buffer Buffer which holds the samples
+     * @param offsetIdx Index of the first sample in the data set
+     * @param policyOffsetIdx Index of the first sparse policy entry in the data set
+     */
+    void write_samples(const TrainGameBuffer& buffer, size_t offsetIdx, size_t policyOffsetIdx);
 
     /**
-     * @brief save_start_idx Saves the current starting index where the next game starts to the game array
+     * @brief start_new_chunk Continues the export at the next chunk boundary if the current chunk has already been written partially.
+     * Chunks which contain committed samples are never written again, so an interrupted export can't damage them.
+     * The skipped samples keep the fill value (no policy entries and sample weight 0), they don't belong to any game
+     * and are dropped by the loader. The mutex must be locked by the caller.
      */
-    void save_start_idx();
+    void start_new_chunk();
 
     /**
-     * @brief open_dataset_from_file Reads a previously exported training set back into memory
-     * @param file filesystem handle
+     * @brief get_policy_offset_idx Returns the index of the first sparse policy entry of a sample chunk.
+     * Every sample chunk owns a region of chunkSize * MAX_NB_LEGAL_MOVES entries which begins at an entry chunk boundary.
+     * @param sampleIdx Index of the first sample of the chunk
+     * @return Index in y_policy_indices and y_policy_probs
      */
-    void open_dataset_from_file(const z5::filesystem::handle::File& file);
+    size_t get_policy_offset_idx(size_t sampleIdx) const;
 
     /**
-     * @brief open_dataset_from_file Creates a new zarr data set given a filesystem handle
-     * @param file filesystem handle
+     * @brief write_commit_attributes Writes the commit attributes to a temporary file which replaces the attribute file of the data set.
+     * The rename is atomic, so an interrupted export leaves either the previous or the new commit state.
+     * @param attributes Commit attributes
      */
-    void create_new_dataset_file(const z5::filesystem::handle::File& file);
+    void write_commit_attributes(const nlohmann::json& attributes);
+
+    /**
+     * @brief open_dataset_from_file Opens the datasets of a previously exported training set
+     */
+    void open_dataset_from_file();
+
+    /**
+     * @brief open_dataset_from_file Creates a new zarr data set
+     */
+    void create_new_dataset_file();
 
     /**
      * @brief apply_result_to_value Inverts the gameValue array if WHITE lost the game.
      * In the case of a draw, all entries are set to 0.
+     * @param buffer Buffer of the finished game
      * @param result Possible values DRAWN, WHITE_WIN, BLACK_WIN,
      */
-    void apply_result_to_value(Result result);
+    void apply_result_to_value(TrainGameBuffer& buffer, Result result) const;
 public:
     /**
-     * @brief TrainDataExporter
+     * @brief TrainDataExporter Creates a new export file. An existing file is overwritten unless resume is set.
      * @param fileNameExport File name of the uncompressed data to be exported in (e.g. "data.zarr")
      * @param numberChunks Defines how many chunks a single file should contain.
      * The product of the number of chunks and its chunk size yields the total number of samples of a file.
      * @param chunkSize Defines the chunk size of a single chunk
+     * @param sparsePolicy If true, the policy is stored as the datasets y_policy_indices, y_policy_probs, y_policy_begins and y_policy_ends
+     * instead of a dense y_policy array. The entries of sample i are in [y_policy_begins[i], y_policy_ends[i]).
+     * @param packPlanes If true, the input planes are stored as the datasets x_masks (uint64) and x_offsets (int16) of shape
+     * (samples, NB_CHANNELS_TOTAL) instead of x. The value of a square is x_offsets + bit of the square in x_masks.
+     * @param rotateShards If true, the samples are exported into the shards <name>_0.zarr, <name>_1.zarr, ... of fileNameExport
+     * and the file is never full. The export continues in the first shard without a manifest.
+     * @param modelName Model name for the manifest of a sealed shard
+     * @param resume If true, an existing file (or unsealed shard) is continued after its last committed game.
+     * It must have been created with the same numberChunks, chunkSize and data format.
+     */
+    TrainDataExporter(const string& fileNameExport, size_t numberChunks=200, size_t chunkSize=128, bool sparsePolicy=false, bool packPlanes=false,
+                      bool rotateShards=false, const string& modelName="", bool resume=false);
+
+    /**
+     * @brief ~TrainDataExporter Writes all remaining samples before the data set is closed
      */
-    TrainDataExporter(const string& fileNameExport, size_t numberChunks=200, size_t chunkSize=128);
+    ~TrainDataExporter();
 
     /**
      * @brief export_pos Saves a given board position, policy and Q-value to the specific game arrays
@@ -147,10 +343,34 @@ public:
      */
     void export_game_samples(Result result);
 
+    /**
+     * @brief save_sample Saves a training sample to the buffer of a game. The data set isn't accessed, so this can be called concurrently for different buffers.
+     * @param buffer Buffer of the current game
+     * @param pos Current board position
+     * @param eval Filled EvalInfo struct after mcts search
+     * @param sampleWeight Weight of the sample in the training loss which is stored in y_sample_weight
+     */
+    void save_sample(TrainGameBuffer& buffer, const Board *pos, const EvalInfo& eval, float sampleWeight=1.0f) const;
+
+    /**
+     * @brief export_game_samples Assigns the game result to all samples of the buffer and appends them to the data set.
+     * Samples which don't fit into the data set anymore are dropped. This can be called from several threads.
+     * @param buffer Buffer of the finished game
+     * @param result Game match result: LOST, DRAW, WON
+     */
+    void export_game_samples(TrainGameBuffer& buffer, Result result);
+
+    /**
+     * @brief flush Writes the samples of an incomplete chunk and waits until all pending writes have finished.
+     * The export continues at the next chunk boundary afterwards.
+     */
+    void flush();
+
     size_t get_number_samples() const;
 
     /**
-     * @brief is_file_full Returns true if the exported data set contains as many samples as initially specified, else false
+     * @brief is_file_full Returns true if the exported data set contains as many samples as initially specified, else false.
+     * When shards are rotated, the export is never full.
      * @return bool
      */
     bool is_file_full();
@@ -30,7 +30,8 @@
 #include "uci.h"
 
 SearchThread::SearchThread(NeuralNetAPI *netBatch, SearchSettings* searchSettings, MapWithMutex* mapWithMutex):
-    netBatch(netBatch), isRunning(false), mapWithMutex(mapWithMutex), searchSettings(searchSettings)
+    netBatch(netBatch), isRunning(false), numberExpansions(0), numberAllocations(0), virtualLoss(searchSettings->virtualLoss),
+    numberBatches(0), numberSelections(0), numberCollisions(0), numberNewNodes(0), numberCollisionVisits(0), maxDepth(0), mapWithMutex(mapWithMutex), searchSettings(searchSettings)
 {
     // allocate memory for all predictions and results
     inputPlanes = new float[searchSettings->batchSize * NB_VALUES_TOTAL];
@@ -42,10 +43,18 @@ SearchThread::SearchThread(NeuralNetAPI *netBatch, SearchSettings* searchSetting
         probOutputs = new NDArray(Shape(searchSettings->batchSize, NB_LABELS), Context::cpu());
     }
     searchLimits = nullptr;  // will be set by set_search_limits() every time before go()
+
+    postProcessingPool = nullptr;
+    if (searchSettings->postProcessingThreads > 0) {
+        postProcessingPool = new WorkerPool(searchSettings->postProcessingThreads);
+    }
+    workingPos = nullptr;  // will be set in set_root_node() if the positions are reconstructed
 }
 
 SearchThread::~SearchThread()
 {
+    delete postProcessingPool;
+    delete workingPos;
     delete [] inputPlanes;
     delete valueOutputs;
     delete probOutputs;
@@ -54,6 +63,23 @@ SearchThread::~SearchThread()
 void SearchThread::set_root_node(Node *value)
 {
     rootNode = value;
+    numberExpansions = 0;
+    numberAllocations = 0;
+    numberBatches = 0;
+    numberSelections = 0;
+    numberCollisions = 0;
+    numberNewNodes = 0;
+    numberCollisionVisits = 0;
+    maxDepth = 0;
+#ifdef PHASE_PROFILING
+    phaseProfile.reset();
+#endif
+
+    if (searchSettings->reconstructPositions) {
+        delete workingPos;
+        workingPos = new Board(*rootNode->get_pos());
+        workingPos->set_state_info(new StateInfo(*(rootNode->get_pos()->get_state_info())));
+    }
 }
 
 void SearchThread::set_search_limits(SearchLimits *s)
@@ -71,11 +97,96 @@ void SearchThread::set_is_running(bool value)
     isRunning = value;
 }
 
+size_t SearchThread::get_number_expansions() const
+{
+    return numberExpansions;
+}
+
+size_t SearchThread::get_number_allocations() const
+{
+    return numberAllocations;
+}
+
+float SearchThread::get_virtual_loss() const
+{
+    return virtualLoss;
+}
+
+size_t SearchThread::get_number_batches() const
+{
+    return numberBatches;
+}
+
+size_t SearchThread::get_number_selections() const
+{
+    return numberSelections;
+}
+
+size_t SearchThread::get_number_collisions() const
+{
+    return numberCollisions;
+}
+
+size_t SearchThread::get_number_new_nodes() const
+{
+    return numberNewNodes;
+}
+
+size_t SearchThread::get_number_collision_visits() const
+{
+    return numberCollisionVisits;
+}
+
+size_t SearchThread::get_max_depth() const
+{
+    return maxDepth.load(memory_order_relaxed);
+}
+
+#ifdef PHASE_PROFILING
+const PhaseProfile& SearchThread::get_phase_profile() const
+{
+    return phaseProfile;
+}
+#endif
+
+Board* SearchThread::reconstruct_position(Node* parentNode, size_t childIdx)
+{
+    pathMoves.clear();
+    pathMoves.push_back(parentNode->get_move(childIdx));
+    for (Node* node = parentNode; node != rootNode; node = node->get_parent_node()) {
+        pathMoves.push_back(node->get_parent_node()->get_move(node->get_child_idx_for_parent()));
+    }
+    // the state infos must not be reallocated while they are referenced by the working board
+    if (pathStates.size() < pathMoves.size()) {
+        pathStates.resize(pathMoves.size());
+    }
+    for (size_t idx = 0; idx < pathMoves.size(); ++idx) {
+        workingPos->do_move(pathMoves[pathMoves.size()-1-idx], pathStates[idx]);
+    }
+    return workingPos;
+}
+
+void SearchThread::restore_working_position()
+{
+    for (Move move : pathMoves) {
+        workingPos->undo_move(move);
+    }
+}
+
 void SearchThread::add_new_node_to_tree(Node* parentNode, size_t childIdx)
 {
-    StateInfo* newState = new StateInfo;
-    Board* newPos = new Board(*parentNode->get_pos());
-    newPos->do_move(parentNode->get_move(childIdx), *newState);
+    PROFILE_PHASE(phaseProfile, PHASE_EXPANSION);
+    const size_t allocationsPreExpansion = get_thread_allocations();
+    Board* newPos;
+    if (searchSettings->reconstructPositions) {
+        newPos = reconstruct_position(parentNode, childIdx);
+    }
+    else {
+        StateInfo* newState = new StateInfo;
+        newPos = new Board(*parentNode->get_pos());
+        newPos->do_move(parentNode->get_move(childIdx), *newState);
+        count_allocations(2);
+    }
 
     mapWithMutex->mtx.lock();
     unordered_map<Key, Node*>::const_iterator it = mapWithMutex->hashTable->find(newPos->hash_key());
@@ -83,18 +194,36 @@ void SearchThread::add_new_node_to_tree(Node* parentNode, size_t childIdx)
     if(searchSettings->useTranspositionTable && it != mapWithMutex->hashTable->end() &&
             is_transposition_verified(it, newPos->get_state_info())) {
         Node *newNode = new Node(*it->second);
-        parentNode->add_transposition_child_node(newNode, newPos, childIdx);
+        count_allocations(1);
+        if (searchSettings->reconstructPositions) {
+            parentNode->add_transposition_child_node(newNode, nullptr, childIdx);
+            restore_working_position();
+        }
+        else {
+            parentNode->add_transposition_child_node(newNode, newPos, childIdx);
+        }
 
         parentNode->increment_no_visit_idx();
         transpositionNodes.push_back(newNode);
+        ++numberExpansions;
     }
     else {
         parentNode->increment_no_visit_idx();
         assert(parentNode != nullptr);
         Node *newNode = new Node(newPos, parentNode, childIdx, searchSettings);
+        count_allocations(1);
         // fill a new board in the input_planes vector
         // we shift the index by NB_VALUES_TOTAL each time
-        board_to_planes(newNode->get_pos(), newNode->get_pos()->number_repetitions(), true, inputPlanes+newNodes.size()*NB_VALUES_TOTAL);
+        {
+            PROFILE_PHASE(phaseProfile, PHASE_ENCODING);
+            board_to_planes(newPos, newPos->number_repetitions(), true, inputPlanes+newNodes.size()*NB_VALUES_TOTAL);
+        }
+
+        if (searchSettings->reconstructPositions) {
+            // the node only keeps the cached position information, the working board is needed for the next rollout
+            newNode->set_pos(nullptr);
+            restore_working_position();
+        }
 
         // connect the Node to the parent
         parentNode->add_new_child_node(newNode, childIdx);
@@ -102,7 +231,10 @@ void SearchThread::add_new_node_to_tree(Node* parentNode, size_t childIdx)
         // save a reference newly created list in the temporary list for node creation
         // it will later be updated with the evaluation of the NN
         newNodes.push_back(newNode);
+        ++numberExpansions;
     }
+    // the counter of this thread also includes the allocations inside of the node constructors
+    numberAllocations += get_thread_allocations() - allocationsPreExpansion;
 }
 
 void SearchThread::stop()
@@ -120,14 +252,14 @@ SearchLimits *SearchThread::get_search_limits() const
     return searchLimits;
 }
 
-Node* get_new_child_to_evaluate(Node* rootNode, size_t& childIdx, NodeDescription& description)
+Node* get_new_child_to_evaluate(Node* rootNode, size_t& childIdx, NodeDescription& description, float virtualLoss)
 {
     Node* currentNode = rootNode;
     description.depth = 0;
     while (true) {
         currentNode->lock();
         childIdx = currentNode->select_child_node();
-        currentNode->apply_virtual_loss_to_child(childIdx);
+        currentNode->apply_virtual_loss_to_child(childIdx, virtualLoss);
         Node* nextNode = currentNode->get_child_node(childIdx);
         description.depth++;
         if (nextNode == nullptr) {
@@ -155,29 +287,61 @@ Node* get_new_child_to_evaluate(Node* rootNode, size_t& childIdx, NodeDescriptio
 
 void SearchThread::set_nn_results_to_child_nodes()
 {
-    size_t batchIdx = 0;
+    const bool isPolicyMap = netBatch->is_policy_map();
+    parallel_for(postProcessingPool, newNodes.size(), [&](size_t startIdx, size_t endIdx) {
+        fill_nn_results_batch(newNodes, startIdx, endIdx, isPolicyMap, valueOutputs, probOutputs, searchSettings->nodePolicyTemperature);
+    });
+    add_new_nodes_to_hash_table();
+}
+
+void SearchThread::add_new_nodes_to_hash_table()
+{
+    mapWithMutex->mtx.lock();
     for (auto node: newNodes) {
-        if (!node->is_terminal()) {
-            fill_nn_results(batchIdx, netBatch->is_policy_map(), valueOutputs, probOutputs, node, searchSettings->nodePolicyTemperature);
-        }
-        ++batchIdx;
-        mapWithMutex->mtx.lock();
-        mapWithMutex->hashTable->insert({node->get_pos()->hash_key(), node});
-        mapWithMutex->mtx.unlock();
+        mapWithMutex->hashTable->insert({node->hash_key(), node});
     }
+    mapWithMutex->update_fill_statistics();
+    mapWithMutex->mtx.unlock();
 }
 
 void SearchThread::backup_value_outputs()
 {
-    backup_values(newNodes);
-    backup_values(transpositionNodes);
-    backup_values(terminalNodes);
+    backup_values(newNodes, virtualLoss);
+    backup_values(transpositionNodes, virtualLoss);
+    backup_values(terminalNodes, virtualLoss);
 }
 
 void SearchThread::backup_collisions()
 {
+    if (searchSettings->multiVisitCollisions) {
+        backup_multi_visit_collisions();
+        return;
+    }
     for (auto node: collisionNodes) {
-        node->get_parent_node()->backup_collision(node->get_child_idx_for_parent());
+        node->get_parent_node()->backup_collision(node->get_child_idx_for_parent(), virtualLoss);
+    }
+    collisionNodes.clear();
+}
+
+void SearchThread::backup_multi_visit_collisions()
+{
+    // all rollouts which collided on the same node share the same path
+    sort(collisionNodes.begin(), collisionNodes.end());
+    for (size_t idx = 0; idx < collisionNodes.size();) {
+        Node* node = collisionNodes[idx];
+        size_t multiplicity = 1;
+        while (idx + multiplicity < collisionNodes.size() && collisionNodes[idx + multiplicity] == node) {
+            ++multiplicity;
+        }
+        if (node->has_nn_results()) {
+            node->get_parent_node()->backup_multi_visit_value(node->get_child_idx_for_parent(), -node->get_value(), virtualLoss, multiplicity);
+            numberCollisionVisits += multiplicity;
+        }
+        else {
+            // the virtual loss is linear, so it can be reverted for all rollouts at once
+            node->get_parent_node()->backup_collision(node->get_child_idx_for_parent(), multiplicity * virtualLoss);
+        }
+        idx += multiplicity;
     }
     collisionNodes.clear();
 }
@@ -198,7 +362,14 @@ void SearchThread::create_mini_batch()
            collisionNodes.size() < searchSettings->batchSize &&
            transpositionNodes.size() < searchSettings->batchSize &&
            terminalNodes.size() < searchSettings->batchSize) {
-        parentNode = get_new_child_to_evaluate(rootNode, childIdx, description);
+        {
+            PROFILE_PHASE(phaseProfile, PHASE_SELECTION);
+            parentNode = get_new_child_to_evaluate(rootNode, childIdx, description, virtualLoss);
+        }
+        ++numberSelections;
+        if (description.depth > maxDepth.load(memory_order_relaxed)) {
+            maxDepth.store(description.depth, memory_order_relaxed);
+        }
 
         if(description.isTerminal) {
             terminalNodes.push_back(parentNode->get_child_node(childIdx));
@@ -206,6 +377,7 @@ void SearchThread::create_mini_batch()
         else if (description.isCollision) {
             // store a pointer to the collision node in order to revert the virtual loss of the forward propagation
             collisionNodes.push_back(parentNode->get_child_node(childIdx));
+            ++numberCollisions;
         }
         else {
             add_new_node_to_tree(parentNode, childIdx);
@@ -213,29 +385,61 @@ void SearchThread::create_mini_batch()
     }
 }
 
+void SearchThread::update_virtual_loss(size_t batchCollisions, size_t batchSelections)
+{
+    if (batchSelections == 0) {
+        return;
+    }
+    const float collisionRatio = float(batchCollisions) / batchSelections;
+    if (collisionRatio > searchSettings->targetCollisionRatio) {
+        virtualLoss = min(virtualLoss * 1.25f, searchSettings->maxVirtualLoss);
+    }
+    else if (collisionRatio < 0.5f * searchSettings->targetCollisionRatio) {
+        virtualLoss = max(virtualLoss * 0.95f, searchSettings->virtualLoss);
+    }
+}
+
 void SearchThread::thread_iteration()
 {
     create_mini_batch();
+    // the virtual loss must stay constant until all rollouts of this mini-batch have been backed up
+    const size_t batchCollisions = collisionNodes.size();
+    const size_t batchSelections = newNodes.size() + collisionNodes.size() + transpositionNodes.size() + terminalNodes.size();
     if (newNodes.size() != 0) {
-        netBatch->predict(inputPlanes, *valueOutputs, *probOutputs);
+        ++numberBatches;
+        numberNewNodes += newNodes.size();
+        {
+            PROFILE_PHASE(phaseProfile, PHASE_INFERENCE);
+            netBatch->predict(inputPlanes, *valueOutputs, *probOutputs);
+        }
+        PROFILE_PHASE(phaseProfile, PHASE_NN_RESULTS);
         set_nn_results_to_child_nodes();
     }
-    backup_value_outputs();
-    backup_collisions();
+    {
+        PROFILE_PHASE(phaseProfile, PHASE_BACKUP_VALUES);
+        backup_value_outputs();
+    }
+    {
+        PROFILE_PHASE(phaseProfile, PHASE_BACKUP_COLLISIONS);
+        backup_collisions();
+    }
+    if (searchSettings->adaptiveVirtualLoss) {
+        update_virtual_loss(batchCollisions, batchSelections);
+    }
 }
 
 void go(SearchThread *t)
 {
-    t->set_is_running(true);
+    // the running flag is set before the thread is started, so that an early stop request can't be overwritten
     while(t->get_is_running() && t->nodes_limits_ok()) {
         t->thread_iteration();
     }
 }
 
-void backup_values(vector<Node*>& nodes)
+void backup_values(vector<Node*>& nodes, float virtualLoss)
 {
     for (auto node: nodes) {
-        node->get_parent_node()->backup_value(node->get_child_idx_for_parent(), -node->get_value());
+        node->get_parent_node()->backup_value(node->get_child_idx_for_parent(), -node->get_value(), virtualLoss);
     }
     nodes.clear();
 }
@@ -253,19 +457,35 @@ void prepare_node_for_nn(Node* newNode, vector<Node*>& newNodes, float* inputPla
 
 void fill_nn_results(size_t batchIdx, bool isPolicyMap, NDArray* valueOutputs, NDArray* probOutputs, Node *node, float temperature)
 {
-    node->set_probabilities_for_moves(get_policy_data_batch(batchIdx, probOutputs, isPolicyMap), get_current_move_lookup(node->side_to_move()));
-    if (!isPolicyMap) {
-        node->apply_softmax_to_policy();
-    }
-    node->apply_temperature_to_prior_policy(temperature);
+    node->set_probabilities_for_moves(get_policy_data_batch(batchIdx, probOutputs, isPolicyMap), get_current_move_lookup(node->side_to_move()),
+                                      isPolicyMap, temperature);
     node->set_value(valueOutputs->At(batchIdx, 0));
     node->enable_has_nn_results();
 }
 
+void fill_nn_results_batch(const vector<Node*>& nodes, size_t startIdx, size_t endIdx, bool isPolicyMap,
+                           const NDArray* valueOutputs, const NDArray* probOutputs, float temperature)
+{
+    // the raw output pointers are only retrieved once for the whole mini-batch
+    const float* valueData = valueOutputs->GetData();
+    const float* policyData = probOutputs->GetData();
+    const size_t policyStride = isPolicyMap ? NB_LABELS_POLICY_MAP : NB_LABELS;
+
+    for (size_t batchIdx = startIdx; batchIdx < endIdx; ++batchIdx) {
+        Node* node = nodes[batchIdx];
+        if (!node->is_terminal()) {
+            node->set_probabilities_for_moves(policyData + batchIdx * policyStride, get_current_move_lookup(node->side_to_move()),
+                                              isPolicyMap, temperature);
+            node->set_value(valueData[batchIdx]);
+            node->enable_has_nn_results();
+        }
+    }
+}
+
 bool is_transposition_verified(const unordered_map<Key,Node*>::const_iterator& it, const StateInfo* stateInfo) {
     return  it->second->has_nn_results() &&
-            it->second->get_pos()->get_state_info()->pliesFromNull == stateInfo->pliesFromNull &&
-            it->second->get_pos()->get_state_info()->rule50 == stateInfo->rule50 &&
+            it->second->get_plies_from_null() == stateInfo->pliesFromNull &&
+            it->second->get_rule50() == stateInfo->rule50 &&
             stateInfo->repetition == 0;
 }
 
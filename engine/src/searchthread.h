@@ -28,18 +28,30 @@
 #ifndef SEARCHTHREAD_H
 #define SEARCHTHREAD_H
 
+#include <atomic>
 #include "node.h"
 #include "constants.h"
 #include "neuralnetapi.h"
 #include "config/searchlimits.h"
+#include "util/workerpool.h"
+#include "util/phaseprofiler.h"
 
 // wrapper for unordered_map with a mutex for thread safe access
 struct MapWithMutex {
     mutex mtx;
     unordered_map<Key, Node*>* hashTable;
+    // number of entries which is refreshed after every modification and can be read without locking the mutex (e.g. for "hashfull")
+    atomic<size_t> numberEntries{0};
     ~MapWithMutex() {
         delete hashTable;
     }
+
+    /**
+     * @brief update_fill_statistics Refreshes numberEntries. Must be called while holding the mutex or while no search is running.
+     */
+    void update_fill_statistics() {
+        numberEntries = hashTable->size();
+    }
 };
 
 
@@ -65,6 +77,35 @@ private:
 
     bool isRunning;
 
+    // number of expanded nodes and the heap allocations they required during the current search
+    size_t numberExpansions;
+    size_t numberAllocations;
+
+    // virtual loss which is applied by this thread, it is adapted after every mini-batch if searchSettings->adaptiveVirtualLoss is set
+    float virtualLoss;
+    // statistics about the mini-batch construction during the current search
+    size_t numberBatches;      // number of mini-batches which have been sent to the neural network
+    size_t numberSelections;   // number of all rollouts
+    size_t numberCollisions;   // number of rollouts which ended in a collision
+    size_t numberNewNodes;     // number of positions which have been evaluated by the neural network
+    size_t numberCollisionVisits;  // number of collisions which have been backed up as regular visits
+    // maximum depth of all rollouts, it is read by the search monitor while the search is running
+    atomic<size_t> maxDepth;
+
+    // optional worker pool which fills the NN results of a mini-batch in parallel
+    WorkerPool* postProcessingPool;
+
+    // working board which is moved along the selected path if the positions are reconstructed during search
+    Board* workingPos;
+    // moves of the current path in reverse order (the last move first) and the state infos used for applying them
+    vector<Move> pathMoves;
+    vector<StateInfo> pathStates;
+
+#ifdef PHASE_PROFILING
+    // accumulated time of each search phase during the current search
+    PhaseProfile phaseProfile;
+#endif
+
     MapWithMutex* mapWithMutex;
     SearchSettings* searchSettings;
     SearchLimits* searchLimits;
@@ -74,6 +115,11 @@ private:
      */
     void set_nn_results_to_child_nodes();
 
+    /**
+     * @brief add_new_nodes_to_hash_table Inserts all newly expanded nodes of the mini-batch into the hash table while holding the lock only once
+     */
+    void add_new_nodes_to_hash_table();
+
     /**
      * @brief backup_value_outputs Backpropagates all newly received value evaluations from the neural network accross the visited search paths
      */
@@ -84,6 +130,34 @@ private:
      */
     void backup_collisions();
 
+    /**
+     * @brief backup_multi_visit_collisions Groups the collision nodes by node. If a node has received its NN evaluation in the meantime
+     * (e.g. because it was expanded in the same mini-batch), its value is backed up once for every collision within a single traversal.
+     * Otherwise only the virtual loss is reverted.
+     */
+    void backup_multi_visit_collisions();
+
+    /**
+     * @brief reconstruct_position Applies all moves from the root node to the given child of the parent node on the working board
+     * @param parentNode Parent node of the node to expand
+     * @param childIdx Child index of the node to expand
+     * @return Working board which describes the position of the new node
+     */
+    Board* reconstruct_position(Node* parentNode, size_t childIdx);
+
+    /**
+     * @brief restore_working_position Undoes all moves of the last call to reconstruct_position(), so that the working board describes the root position again
+     */
+    void restore_working_position();
+
+    /**
+     * @brief update_virtual_loss Increases the virtual loss if too many rollouts of the last mini-batch ended in a collision
+     * and slowly decreases it back to the default value otherwise
+     * @param batchCollisions Number of collisions in the last mini-batch
+     * @param batchSelections Number of rollouts in the last mini-batch
+     */
+    void update_virtual_loss(size_t batchCollisions, size_t batchSelections);
+
 public:
     /**
      * @brief SearchThread
@@ -126,10 +200,27 @@ public:
     void set_root_node(Node *value);
     bool get_is_running() const;
     void set_is_running(bool value);
+    size_t get_number_expansions() const;
+    size_t get_number_allocations() const;
+    float get_virtual_loss() const;
+    size_t get_number_batches() const;
+    size_t get_number_selections() const;
+    size_t get_number_collisions() const;
+    size_t get_number_new_nodes() const;
+    size_t get_number_collision_visits() const;
+    size_t get_max_depth() const;
+#ifdef PHASE_PROFILING
+    const PhaseProfile& get_phase_profile() const;
+#endif
 
     void add_new_node_to_tree(Node* parentNode, size_t childIdx);
 };
 
+/**
+ * @brief go Runs the rollouts of the given search thread until it is stopped or the node limit is reached.
+ * The thread must be marked as running with set_is_running() beforehand.
+ * @param t Search thread
+ */
 void go(SearchThread *t);
 
 struct NodeDescription
@@ -148,14 +239,29 @@ struct NodeDescription
  * @param useTranspositionTable Flag if the transposition table shall be used
  * @param hashTable Pointer to the hashTable
  * @param description Output struct which holds information what type of node it is
+ * @param virtualLoss Virtual loss which is applied along the selected path
  * @return Pointer to next child to evaluate (can also be terminal or tranposition node in which case no NN eval is required)
  */
-Node* get_new_child_to_evaluate(Node* rootNode, size_t& childIdx, NodeDescription& description);
+Node* get_new_child_to_evaluate(Node* rootNode, size_t& childIdx, NodeDescription& description, float virtualLoss);
 
-void backup_values(vector<Node*>& nodes);
+void backup_values(vector<Node*>& nodes, float virtualLoss);
 
 void fill_nn_results(size_t batchIdx, bool is_policy_map, NDArray* valueOutputs, NDArray* probOutputs, Node *node, float nodeTemperature);
 
+/**
+ * @brief fill_nn_results_batch Sets the value and prior policy for all nodes of a mini-batch in the range [startIdx, endIdx).
+ * The node at position i in the vector relates to the batch index i. Terminal nodes are skipped.
+ * @param nodes Newly expanded nodes of the mini-batch
+ * @param startIdx First batch index to process
+ * @param endIdx Batch index after the last one to process
+ * @param isPolicyMap Sets if the policy is encoded in policy map representation
+ * @param valueOutputs Value predictions of the mini-batch
+ * @param probOutputs Policy predictions of the mini-batch
+ * @param temperature Temperature which is applied to the prior policy of each node
+ */
+void fill_nn_results_batch(const vector<Node*>& nodes, size_t startIdx, size_t endIdx, bool isPolicyMap,
+                           const NDArray* valueOutputs, const NDArray* probOutputs, float temperature);
+
 bool is_transposition_verified(const unordered_map<Key,Node*>::const_iterator& it, const StateInfo* stateInfo);
 
 #endif // SEARCHTHREAD_H
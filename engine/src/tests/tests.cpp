@@ -33,6 +33,10 @@
 #include "thread.h"
 #include "../domain/crazyhouse/constants.h"
 #include "../domain/crazyhouse/inputrepresentation.h"
+#include "../domain/crazyhouse/outputrepresentation.h"
+#include "../util/blazeutil.h"
+#include "../manager/dynamictimemanager.h"
+#include "../rl/tournamentresult.h"
 using namespace Catch::literals;
 using namespace std;
 
@@ -79,4 +83,82 @@ TEST_CASE("Anti-Chess StartFEN"){
     REQUIRE(int(sum) == 224);
     REQUIRE(int(key) == 417296);
 }
+
+TEST_CASE("Fused policy softmax with temperature"){
+    const vector<Move> legalMoves = {make_move(SQ_E2, SQ_E4), make_move(SQ_D2, SQ_D4), make_move(SQ_G1, SQ_F3)};
+    unordered_map<Move, size_t> moveLookup = {{legalMoves[0], 2}, {legalMoves[1], 0}, {legalMoves[2], 3}};
+    const float policyOutput[] = {0.5f, 7.0f, -1.0f, 2.0f};
+    const float temperature = 2.0f;
+
+    // reference: gather, softmax and temperature scaling as separate passes
+    DynamicVector<float> expected(legalMoves.size());
+    get_probs_of_moves(policyOutput, legalMoves, moveLookup, expected);
+    apply_softmax(expected);
+    apply_temperature(expected, temperature);
+
+    DynamicVector<float> fused(legalMoves.size());
+    get_probs_of_moves_with_temperature(policyOutput, legalMoves, moveLookup, false, temperature, fused);
+
+    for (size_t idx = 0; idx < legalMoves.size(); ++idx) {
+        REQUIRE(fused[idx] == Approx(expected[idx]));
+    }
+    REQUIRE(sum(fused) == Approx(1.0f));
+}
+
+TEST_CASE("Dynamic time manager"){
+    SearchTrace clearTrace;
+    clearTrace.movetime = 1000;
+    clearTrace.maxTimeMS = 5000;
+    SearchTrace unclearTrace = clearTrace;
+    for (int elapsedMS = 100; elapsedMS <= 3000; elapsedMS += 100) {
+        // the best move is dominant from the start
+        clearTrace.snapshots.push_back({elapsedMS, 0, 0.9f, 0.3f});
+        // the best move changes every 500ms and is hardly better than the runner-up
+        unclearTrace.snapshots.push_back({elapsedMS, size_t(elapsedMS / 500 % 2), 0.5f, 0.01f});
+    }
+
+    const DynamicTimeSettings settings;
+    TimeSimulationResult result = simulate_time_manager({clearTrace}, settings);
+    REQUIRE(result.numberSearches == 1);
+    REQUIRE(result.earlyStops == 1);
+    // the best move must be stable for stabilityFactor * movetime after the first snapshot
+    REQUIRE(result.avgTimeRatio == Approx(0.4f));
+
+    // the unclear search is extended until the hard cap of maxTimeFactor * movetime
+    result = simulate_time_manager({unclearTrace}, settings);
+    REQUIRE(result.extensions == 1);
+    REQUIRE(result.avgTimeRatio == Approx(settings.maxTimeFactor));
+}
+
+TEST_CASE("Tournament result elo and SPRT"){
+    REQUIRE(score_to_elo(elo_to_score(100.0f)) == Approx(100.0f));
+    REQUIRE(elo_to_score(0.0f) == Approx(0.5f));
+
+    TournamentResult result;
+    result.numberWins = 60;
+    result.numberDraws = 20;
+    result.numberLosses = 20;
+    REQUIRE(result.elo() == Approx(147.19f).epsilon(0.01));
+    REQUIRE(result.elo_error() > 0.0f);
+    REQUIRE(result.sprt(0, 20, 0.05f, 0.05f) == SPRT_ACCEPT_H1);
+
+    swap(result.numberWins, result.numberLosses);
+    REQUIRE(result.elo() == Approx(-147.19f).epsilon(0.01));
+    REQUIRE(result.sprt(0, 20, 0.05f, 0.05f) == SPRT_ACCEPT_H0);
+
+    // an even match of few games is not decided yet
+    result.numberWins = 10;
+    result.numberDraws = 80;
+    result.numberLosses = 10;
+    REQUIRE(result.elo() == Approx(0.0f).margin(1e-3));
+    REQUIRE(result.sprt(0, 20, 0.05f, 0.05f) == SPRT_CONTINUE);
+
+    // a match without any loss can be decided as well
+    result.numberWins = 40;
+    result.numberDraws = 10;
+    result.numberLosses = 0;
+    REQUIRE(result.sprt(0, 20, 0.05f, 0.05f) == SPRT_ACCEPT_H1);
+    result.numberDraws = 0;
+    REQUIRE(result.sprt(0, 20, 0.05f, 0.05f) == SPRT_ACCEPT_H1);
+}
 #endif
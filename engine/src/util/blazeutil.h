@@ -233,4 +233,27 @@ void apply_permutation_in_place(std::vector<T>& vec, const std::vector<std::size
     }
 }
 
+template <typename T>
+void apply_permutation_in_place(T* data, std::size_t size, const std::vector<std::size_t>& p)
+{
+    std::vector<bool> done(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        if (done[i])
+        {
+            continue;
+        }
+        done[i] = true;
+        std::size_t prev_j = i;
+        std::size_t j = p[i];
+        while (i != j)
+        {
+            std::swap(data[prev_j], data[j]);
+            done[j] = true;
+            prev_j = j;
+            j = p[j];
+        }
+    }
+}
+
 #endif // BLAZEUTIL_H
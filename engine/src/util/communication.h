@@ -61,6 +61,18 @@ void info_score(const T &message) {
 #endif
 }
 
+/**
+ * @brief info_multi_pv Prints the score information of one line of a MultiPV search in accordance with the UCI-protocol.
+ * @param multiPvIdx Rank of the line starting with 1
+ * @param message Score information of the line
+ */
+template<typename T>
+void info_multi_pv(size_t multiPvIdx, const T &message) {
+#ifndef USE_RL
+    cout << "info multipv " << multiPvIdx << " score " << message << endl;
+#endif
+}
+
 template<typename T>
 void info_bestmove(const T &message) {
 #ifndef USE_RL
@@ -0,0 +1,95 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: phaseprofiler.cpp
+ * Created on 19.10.2026
+ * @author: queensgambit
+ */
+
+#include "phaseprofiler.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include "communication.h"
+
+const char* const SEARCH_PHASE_NAMES[NB_SEARCH_PHASES] = {
+    "selection",
+    "expansion (incl. encoding)",
+    "encoding",
+    "inference",
+    "nn results",
+    "backup values",
+    "backup collisions"
+};
+
+PhaseProfile::PhaseProfile()
+{
+    reset();
+}
+
+void PhaseProfile::reset()
+{
+    fill(nanoseconds, nanoseconds+NB_SEARCH_PHASES, 0);
+    fill(calls, calls+NB_SEARCH_PHASES, 0);
+}
+
+void PhaseProfile::merge(const PhaseProfile& other)
+{
+    for (size_t phase = 0; phase < NB_SEARCH_PHASES; ++phase) {
+        nanoseconds[phase] += other.nanoseconds[phase];
+        calls[phase] += other.calls[phase];
+    }
+}
+
+ScopedPhaseTimer::ScopedPhaseTimer(PhaseProfile& profile, SearchPhase phase):
+    profile(profile),
+    phase(phase),
+    startTime(chrono::steady_clock::now())
+{
+}
+
+ScopedPhaseTimer::~ScopedPhaseTimer()
+{
+    profile.nanoseconds[phase] += uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - startTime).count());
+    ++profile.calls[phase];
+}
+
+void print_phase_profile(const PhaseProfile& profile)
+{
+    uint64_t totalNanoseconds = 0;
+    for (size_t phase = 0; phase < NB_SEARCH_PHASES; ++phase) {
+        // the encoding is already part of the expansion
+        if (phase != PHASE_ENCODING) {
+            totalNanoseconds += profile.nanoseconds[phase];
+        }
+    }
+    if (totalNanoseconds == 0) {
+        return;
+    }
+    for (size_t phase = 0; phase < NB_SEARCH_PHASES; ++phase) {
+        stringstream ss;
+        ss << fixed << setprecision(1) << profile.nanoseconds[phase] / 1e6 << " ms "
+           << 100.0 * profile.nanoseconds[phase] / totalNanoseconds << "% ";
+        if (profile.calls[phase] != 0) {
+            ss << setprecision(2) << profile.nanoseconds[phase] / 1e3 / profile.calls[phase] << " us/call";
+        }
+        info_string(SEARCH_PHASE_NAMES[phase], ss.str());
+    }
+}
@@ -0,0 +1,99 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: phaseprofiler.h
+ * Created on 19.10.2026
+ * @author: queensgambit
+ *
+ * Low overhead timers which accumulate the time spent in the individual phases of a search thread.
+ * The instrumentation is only compiled in if PHASE_PROFILING is defined (cmake option USE_PHASE_PROFILING).
+ */
+
+#ifndef PHASEPROFILER_H
+#define PHASEPROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+enum SearchPhase {
+    PHASE_SELECTION,
+    PHASE_EXPANSION,
+    PHASE_ENCODING,
+    PHASE_INFERENCE,
+    PHASE_NN_RESULTS,
+    PHASE_BACKUP_VALUES,
+    PHASE_BACKUP_COLLISIONS,
+    NB_SEARCH_PHASES
+};
+
+struct PhaseProfile
+{
+    uint64_t nanoseconds[NB_SEARCH_PHASES];
+    size_t calls[NB_SEARCH_PHASES];
+
+    PhaseProfile();
+
+    /**
+     * @brief reset Sets all accumulated times and call counts to zero
+     */
+    void reset();
+
+    /**
+     * @brief merge Adds the accumulated times and call counts of a different profile, e.g. of another search thread
+     * @param other Profile to add
+     */
+    void merge(const PhaseProfile& other);
+};
+
+/**
+ * @brief The ScopedPhaseTimer class adds the time between its construction and destruction to the given phase of the profile
+ */
+class ScopedPhaseTimer
+{
+private:
+    PhaseProfile& profile;
+    SearchPhase phase;
+    chrono::steady_clock::time_point startTime;
+
+public:
+    ScopedPhaseTimer(PhaseProfile& profile, SearchPhase phase);
+    ~ScopedPhaseTimer();
+};
+
+/**
+ * @brief print_phase_profile Prints the total time, its share and the average time per call of each phase as info strings
+ * @param profile Accumulated profile of all search threads
+ */
+void print_phase_profile(const PhaseProfile& profile);
+
+#define PHASE_PROFILER_CONCAT_IMPL(a, b) a##b
+#define PHASE_PROFILER_CONCAT(a, b) PHASE_PROFILER_CONCAT_IMPL(a, b)
+
+#ifdef PHASE_PROFILING
+// measures the time until the end of the current scope and adds it to the given phase
+#define PROFILE_PHASE(profile, phase) ScopedPhaseTimer PHASE_PROFILER_CONCAT(phaseTimer, __LINE__)(profile, phase)
+#else
+#define PROFILE_PHASE(profile, phase)
+#endif
+
+#endif // PHASEPROFILER_H
@@ -30,9 +30,9 @@
 
 #include <random>
 
-// random generator used for all sort of distributions
-static std::random_device r;
-static std::default_random_engine generator(r());
+// random generator used for all sort of distributions,
+// every thread has its own engine with its own seed, so parallel games neither share nor correlate their random state
+static thread_local std::default_random_engine generator(std::random_device{}());
 
 /**
  * @brief random_exponential Generates a random sample from a exponential distribution with a given mean.
@@ -45,4 +45,26 @@ T random_exponential(T lambda) {
     return distribution(generator);
 }
 
+/**
+ * @brief random_uniform Generates a random sample from a uniform distribution in [minValue, maxValue)
+ * @param minValue Lower bound
+ * @param maxValue Upper bound
+ * @return Generated value
+ */
+template<typename T>
+T random_uniform(T minValue, T maxValue) {
+    std::uniform_real_distribution<T> distribution(minValue, maxValue);
+    return distribution(generator);
+}
+
+/**
+ * @brief random_index Generates a uniformly distributed index in [0, size)
+ * @param size Number of possible indices (must be greater than 0)
+ * @return Generated index
+ */
+inline size_t random_index(size_t size) {
+    std::uniform_int_distribution<size_t> distribution(0, size - 1);
+    return distribution(generator);
+}
+
 #endif // RANDOMGEN_H
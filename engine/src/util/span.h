@@ -0,0 +1,73 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: span.h
+ * Created on 19.10.2026
+ * @author: queensgambit
+ *
+ * Non-owning view on a contiguous array (similar to std::span of C++20).
+ */
+
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+
+template <typename T>
+class Span
+{
+private:
+    T* ptr;
+    size_t length;
+
+public:
+    Span():
+        ptr(nullptr), length(0) {}
+
+    Span(T* ptr, size_t length):
+        ptr(ptr), length(length) {}
+
+    // allows passing a vector wherever a read-only span is expected
+    Span(const std::vector<typename std::remove_const<T>::type>& vec):
+        ptr(vec.data()), length(vec.size()) {}
+
+    T* begin() const {
+        return ptr;
+    }
+    T* end() const {
+        return ptr + length;
+    }
+    T* data() const {
+        return ptr;
+    }
+    size_t size() const {
+        return length;
+    }
+    bool empty() const {
+        return length == 0;
+    }
+    T& operator[](size_t idx) const {
+        return ptr[idx];
+    }
+};
+
+#endif // SPAN_H
@@ -0,0 +1,158 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: workerpool.cpp
+ * Created on 19.10.2026
+ * @author: queensgambit
+ */
+
+#include "workerpool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t numberThreads):
+    pendingTasks(0), unclaimedTasks(0), nextQueueIdx(0), running(true)
+{
+    for (size_t idx = 0; idx < numberThreads; ++idx) {
+        queues.push_back(new WorkerQueue());
+    }
+    for (size_t idx = 0; idx < numberThreads; ++idx) {
+        workers.emplace_back(&WorkerPool::worker_loop, this, idx);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    mtx.lock();
+    running = false;
+    mtx.unlock();
+    taskAvailable.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    for (WorkerQueue* queue : queues) {
+        delete queue;
+    }
+}
+
+bool WorkerPool::pop_task(size_t workerIdx, function<void()>& task)
+{
+    for (size_t offset = 0; offset < queues.size(); ++offset) {
+        WorkerQueue* queue = queues[(workerIdx + offset) % queues.size()];
+        lock_guard<mutex> lock(queue->mtx);
+        if (queue->tasks.empty()) {
+            continue;
+        }
+        --unclaimedTasks;
+        if (offset == 0) {
+            // the own queue is processed in LIFO order because its latest task is the most likely to be cache-hot
+            task = move(queue->tasks.back());
+            queue->tasks.pop_back();
+        }
+        else {
+            task = move(queue->tasks.front());
+            queue->tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void WorkerPool::worker_loop(size_t workerIdx)
+{
+    while (true) {
+        function<void()> task;
+        if (!pop_task(workerIdx, task)) {
+            unique_lock<mutex> lock(mtx);
+            taskAvailable.wait(lock, [this]{ return !running || unclaimedTasks != 0; });
+            if (unclaimedTasks == 0) {
+                // the pool is shutting down and all tasks have been processed
+                return;
+            }
+            // the task may have been taken by another worker in the meantime, so the queues are searched again
+            continue;
+        }
+        task();
+        {
+            lock_guard<mutex> lock(mtx);
+            --pendingTasks;
+            if (pendingTasks == 0) {
+                tasksFinished.notify_all();
+            }
+        }
+    }
+}
+
+void WorkerPool::enqueue(const function<void()>& task)
+{
+    if (queues.empty()) {
+        // without any workers the task is executed directly
+        task();
+        return;
+    }
+    WorkerQueue* queue = queues[nextQueueIdx++ % queues.size()];
+    mtx.lock();
+    ++pendingTasks;
+    mtx.unlock();
+
+    // the counter is changed together with the queue, so it never counts a task which can't be found
+    queue->mtx.lock();
+    queue->tasks.push_back(task);
+    ++unclaimedTasks;
+    queue->mtx.unlock();
+
+    // a worker which has just checked the counter is waiting already when the pool mutex is released, so the signal isn't lost
+    mtx.lock();
+    mtx.unlock();
+    taskAvailable.notify_one();
+}
+
+void WorkerPool::wait_all()
+{
+    unique_lock<mutex> lock(mtx);
+    tasksFinished.wait(lock, [this]{ return pendingTasks == 0; });
+}
+
+bool WorkerPool::wait_all_for(chrono::milliseconds timeout)
+{
+    unique_lock<mutex> lock(mtx);
+    return tasksFinished.wait_for(lock, timeout, [this]{ return pendingTasks == 0; });
+}
+
+size_t WorkerPool::get_number_threads() const
+{
+    return workers.size();
+}
+
+void parallel_for(WorkerPool* pool, size_t numberElements, const function<void(size_t, size_t)>& func)
+{
+    if (pool == nullptr || pool->get_number_threads() == 0 || numberElements < 2) {
+        func(0, numberElements);
+        return;
+    }
+    // the calling thread takes over one of the blocks
+    const size_t numberBlocks = min(pool->get_number_threads() + 1, numberElements);
+    const size_t blockSize = (numberElements + numberBlocks - 1) / numberBlocks;
+    for (size_t startIdx = blockSize; startIdx < numberElements; startIdx += blockSize) {
+        const size_t endIdx = min(startIdx + blockSize, numberElements);
+        pool->enqueue([&func, startIdx, endIdx]{ func(startIdx, endIdx); });
+    }
+    func(0, blockSize);
+    pool->wait_all();
+}
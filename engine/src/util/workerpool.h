@@ -0,0 +1,127 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: workerpool.h
+ * Created on 19.10.2026
+ * @author: queensgambit
+ *
+ * Small fixed size worker pool for splitting work (e.g. the post-processing of a mini-batch or the search threads of a move)
+ * across several threads without creating new threads every time.
+ * Every worker has its own task queue and steals tasks from the other queues when its own queue is empty.
+ * The queues are only protected by their own mutex, the pool mutex is just used for putting idle workers to sleep.
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <atomic>
+
+using namespace std;
+
+// task queue of a single worker
+struct WorkerQueue {
+    mutex mtx;
+    deque<function<void()>> tasks;
+};
+
+class WorkerPool
+{
+private:
+    vector<thread> workers;
+    vector<WorkerQueue*> queues;
+    mutex mtx;
+    // signals the workers that a new task is available or that the pool is shutting down
+    condition_variable taskAvailable;
+    // signals waiting threads that all enqueued tasks have been processed
+    condition_variable tasksFinished;
+    // number of tasks which have been enqueued but not finished yet
+    size_t pendingTasks;
+    // number of tasks which are waiting in one of the queues, idle workers sleep while it is 0
+    atomic<size_t> unclaimedTasks;
+    // queue which receives the next enqueued task (round robin)
+    atomic<size_t> nextQueueIdx;
+    bool running;
+
+    /**
+     * @brief worker_loop Processes tasks until the pool is destroyed
+     * @param workerIdx Index of the worker and its own queue
+     */
+    void worker_loop(size_t workerIdx);
+
+    /**
+     * @brief pop_task Takes the newest task of the worker's own queue or steals the oldest task of another queue.
+     * Only the mutex of the visited queues is locked.
+     * @param workerIdx Index of the worker
+     * @param task Output task
+     * @return True, if a task was found
+     */
+    bool pop_task(size_t workerIdx, function<void()>& task);
+
+public:
+    /**
+     * @brief WorkerPool Starts the given number of worker threads
+     * @param numberThreads Number of worker threads
+     */
+    WorkerPool(size_t numberThreads);
+
+    /**
+     * @brief ~WorkerPool Finishes all remaining tasks and joins the worker threads
+     */
+    ~WorkerPool();
+
+    /**
+     * @brief enqueue Adds a new task to one of the worker queues. It will be processed by this worker or stolen by the next idle one.
+     * @param task Function to execute
+     */
+    void enqueue(const function<void()>& task);
+
+    /**
+     * @brief wait_all Blocks until all enqueued tasks have been processed
+     */
+    void wait_all();
+
+    /**
+     * @brief wait_all_for Blocks until all enqueued tasks have been processed or the timeout has been reached
+     * @param timeout Maximum waiting time
+     * @return True, if all tasks have been processed
+     */
+    bool wait_all_for(chrono::milliseconds timeout);
+
+    size_t get_number_threads() const;
+};
+
+/**
+ * @brief parallel_for Splits the index range [0, numberElements) into contiguous blocks and processes them in parallel.
+ * The calling thread processes the first block itself and returns as soon as all blocks are done.
+ * If no pool is given, the whole range is processed by the calling thread.
+ * @param pool Worker pool (can be a nullptr)
+ * @param numberElements Total number of elements
+ * @param func Function which processes all elements in [startIdx, endIdx)
+ */
+void parallel_for(WorkerPool* pool, size_t numberElements, const function<void(size_t startIdx, size_t endIdx)>& func);
+
+#endif // WORKERPOOL_H